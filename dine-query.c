@@ -0,0 +1,503 @@
+// dine-query.c
+// Questions about a trace written by dine --trace, answered from interval
+// indexes built in one pass over it:
+//
+//   holder FORK [T1 T2]    who held the fork, and when
+//   state PHIL [T1 T2]     what the philosopher was doing, and when
+//   hungry PHIL [T1 T2]    the philosopher's longest hungry stretch
+//   eaters K [T1 T2]       stretches with at least K philosophers eating
+//
+// Each index is a list of half-open [start, end) spans sorted by start
+// that never overlap, so their ends are sorted too: the first span
+// reaching into a window is a binary search away, and the rest follow
+// in order. Hungry stretches also get a sparse table of their longest
+// span over every power-of-two run, so the longest one in any window is
+// two lookups plus the two clipped spans at its edges.
+//
+// Times are ns since the run started; a suffix of us, ms or s scales
+// them. Philosophers are letters (A, B, ...) or numbers, forks numbers.
+// With no query on the command line, queries are read one per line from
+// stdin against the one index. Where tracing was switched off and on
+// again, spans end at the last event before the gap and start again at
+// the snapshot after it.
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "trace.h"
+
+// philosopher states, as dine numbers them
+enum { ST_CHANGING = 0, ST_EATING, ST_THINKING };
+
+static const char *state_names[] = { "changing", "eating", "thinking" };
+
+// ----- spans -----
+
+typedef struct {
+    long long start, end;
+    int who;                // fork owner or philosopher state
+    int open;               // still going when the trace ended
+}
+span_t;
+
+typedef struct {
+    span_t *v;
+    long len, cap;
+}
+spans_t;
+
+static void spans_push(spans_t *s, long long start, long long end, int who,
+                       int open) {
+    if (s->len == s->cap) {
+        long cap = s->cap ? 2 * s->cap : 64;
+        span_t *grown = realloc(s->v, (size_t)cap * sizeof *grown);
+        if (grown == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+        s->v = grown;
+        s->cap = cap;
+    }
+    s->v[s->len++] = (span_t){ start, end, who, open };
+}
+
+// first span ending after t
+static long spans_first(const spans_t *s, long long t) {
+    long lo = 0, hi = s->len;
+    while (lo < hi) {
+        long mid = lo + (hi - lo) / 2;
+        if (s->v[mid].end > t) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+// one past the last span starting at or before t
+static long spans_last(const spans_t *s, long long t) {
+    long lo = 0, hi = s->len;
+    while (lo < hi) {
+        long mid = lo + (hi - lo) / 2;
+        if (s->v[mid].start > t) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+// ----- indexes -----
+
+static int g_n;
+static long long g_end;             // last event's time
+static spans_t *g_forks;            // per fork: who held it
+static spans_t *g_states;           // per philosopher: its states
+static spans_t *g_hungry;           // per philosopher: changing -> eating
+static spans_t *g_eaters;           // per k: at least k eating
+
+// per philosopher, g_best[p][j][i] is the longest of hungry spans
+// i .. i + 2^j - 1
+static long **g_best[TRACE_MAX_N];
+
+static long long span_len(const span_t *s) {
+    return s->end - s->start;
+}
+
+static void build_best(int p) {
+    const spans_t *h = &g_hungry[p];
+    int levels = 1;
+    while ((1L << levels) <= h->len) levels++;
+    g_best[p] = malloc((size_t)levels * sizeof *g_best[p]);
+    if (g_best[p] == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    for (int j = 0; j < levels; j++) {
+        long width = 1L << j;
+        long count = h->len - width + 1 > 0 ? h->len - width + 1 : 0;
+        long *row = malloc((size_t)(count > 0 ? count : 1) * sizeof *row);
+        if (row == NULL) {
+            perror("malloc");
+            exit(1);
+        }
+        for (long i = 0; i < count; i++) {
+            if (j == 0) {
+                row[i] = i;
+                continue;
+            }
+            long a = g_best[p][j - 1][i];
+            long b = g_best[p][j - 1][i + width / 2];
+            row[i] = span_len(&h->v[b]) > span_len(&h->v[a]) ? b : a;
+        }
+        g_best[p][j] = row;
+    }
+}
+
+// longest of hungry spans lo .. hi - 1 (lo < hi)
+static long best_in(int p, long lo, long hi) {
+    int j = 0;
+    while ((1L << (j + 1)) <= hi - lo) j++;
+    long a = g_best[p][j][lo];
+    long b = g_best[p][j][hi - (1L << j)];
+    const span_t *v = g_hungry[p].v;
+    return span_len(&v[b]) > span_len(&v[a]) ? b : a;
+}
+
+static long long wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// what is open while building: who holds each fork and since when,
+// each philosopher's state and hungry stretch, and the eater levels
+static int o_owner[TRACE_MAX_N], o_state[TRACE_MAX_N];
+static long long o_held_since[TRACE_MAX_N], o_state_since[TRACE_MAX_N];
+static long long o_hungry_since[TRACE_MAX_N];
+static long long o_level_since[TRACE_MAX_N + 1];
+static int o_eating;
+
+static void eaters_up(long long ts) {
+    o_level_since[++o_eating] = ts;
+}
+
+static void eaters_down(long long ts) {
+    if (ts > o_level_since[o_eating]) {
+        spans_push(&g_eaters[o_eating], o_level_since[o_eating], ts,
+                   o_eating, 0);
+    }
+    o_eating--;
+}
+
+// closes every open span at ts; open marks the trace's end
+static void close_all(long long ts, int open) {
+    for (int i = 0; i < g_n; i++) {
+        if (o_owner[i] >= 0) {
+            spans_push(&g_forks[i], o_held_since[i], ts, o_owner[i], open);
+        }
+        if (o_state[i] >= 0) {
+            spans_push(&g_states[i], o_state_since[i], ts, o_state[i], open);
+        }
+        o_owner[i] = o_state[i] = -1;
+        o_hungry_since[i] = -1;
+    }
+    while (o_eating > 0) {
+        spans_push(&g_eaters[o_eating], o_level_since[o_eating], ts,
+                   o_eating, open);
+        o_eating--;
+    }
+}
+
+// opens spans for frame f at f->ts: at the start, and at a TRACE_SYNC,
+// where tracing resumed after a gap
+static void resync(const trace_frame_t *f) {
+    long long ts = f->ts;
+    int owner[TRACE_MAX_N];
+    for (int i = 0; i < g_n; i++) owner[i] = -1;
+    for (int p = 0; p < g_n; p++) {
+        if (f->hold[p] & 1) owner[p] = p;
+        if (f->hold[p] & 2) owner[(p + 1) % g_n] = p;
+    }
+    for (int i = 0; i < g_n; i++) {
+        if (owner[i] == o_owner[i]) continue;
+        if (o_owner[i] >= 0) {
+            spans_push(&g_forks[i], o_held_since[i], ts, o_owner[i], 0);
+        }
+        o_owner[i] = owner[i];
+        o_held_since[i] = ts;
+    }
+    int eating = 0;
+    for (int p = 0; p < g_n; p++) {
+        eating += f->state[p] == ST_EATING;
+        if (f->state[p] == o_state[p]) continue;
+        // a hungry stretch that ran into the gap has no known end
+        o_hungry_since[p] = -1;
+        if (o_state[p] >= 0) {
+            spans_push(&g_states[p], o_state_since[p], ts, o_state[p], 0);
+        }
+        o_state[p] = f->state[p];
+        o_state_since[p] = ts;
+    }
+    while (o_eating > eating) eaters_down(ts);
+    while (o_eating < eating) eaters_up(ts);
+}
+
+// one pass over the trace; 0 on success
+static int build_index(const char *path) {
+    long long t0 = wall_ns();
+    trace_reader_t *r = trace_open(path);
+    if (r == NULL) return -1;
+    g_n = trace_n(r);
+    trace_frame_t f;
+    if (trace_seek_event(r, 0, &f) != 0) {
+        fprintf(stderr, "%s: cannot read the first keyframe\n", path);
+        trace_close(r);
+        return -1;
+    }
+
+    g_forks = calloc((size_t)g_n, sizeof *g_forks);
+    g_states = calloc((size_t)g_n, sizeof *g_states);
+    g_hungry = calloc((size_t)g_n, sizeof *g_hungry);
+    g_eaters = calloc((size_t)g_n + 1, sizeof *g_eaters);
+    if (!g_forks || !g_states || !g_hungry || !g_eaters) {
+        perror("calloc");
+        exit(1);
+    }
+
+    for (int i = 0; i < g_n; i++) {
+        o_owner[i] = o_state[i] = -1;
+        o_hungry_since[i] = -1;
+    }
+    resync(&f);
+
+    trace_event_t ev;
+    g_end = f.ts;
+    while (trace_next(r, &f, &ev)) {
+        if (ev.kind == TRACE_SYNC) {
+            // nothing is known about the gap: end everything at the last
+            // event before it
+            close_all(g_end, 0);
+            resync(&f);
+            g_end = ev.ts;
+            continue;
+        }
+        g_end = ev.ts;
+        if (ev.pid < 0 || ev.pid >= g_n) continue;
+        if (ev.kind == TRACE_GRANT && ev.arg >= 0 && ev.arg < g_n) {
+            o_owner[ev.arg] = ev.pid;
+            o_held_since[ev.arg] = ev.ts;
+        } else if (ev.kind == TRACE_POST && ev.arg >= 0 && ev.arg < g_n) {
+            if (o_owner[ev.arg] == ev.pid) {
+                spans_push(&g_forks[ev.arg], o_held_since[ev.arg], ev.ts,
+                           ev.pid, 0);
+            }
+            o_owner[ev.arg] = -1;
+        } else if (ev.kind == TRACE_STATE) {
+            int p = ev.pid, to = ev.arg;
+            // hungry from the latest switch to changing until eating, as
+            // dine --stats measures it
+            if (to == ST_CHANGING) {
+                if (o_state[p] != ST_EATING) o_hungry_since[p] = ev.ts;
+            } else if (to == ST_EATING && o_hungry_since[p] >= 0) {
+                spans_push(&g_hungry[p], o_hungry_since[p], ev.ts, p, 0);
+                o_hungry_since[p] = -1;
+            } else {
+                o_hungry_since[p] = -1;
+            }
+            if (to == o_state[p]) continue;
+            spans_push(&g_states[p], o_state_since[p], ev.ts, o_state[p], 0);
+            if (to == ST_EATING) {
+                eaters_up(ev.ts);
+            } else if (o_state[p] == ST_EATING) {
+                eaters_down(ev.ts);
+            }
+            o_state[p] = to;
+            o_state_since[p] = ev.ts;
+        }
+    }
+
+    // close what was still open at the end; a philosopher still hungry
+    // then had finished or been stopped, not kept waiting
+    close_all(g_end, 1);
+    for (int p = 0; p < g_n; p++) build_best(p);
+
+    fprintf(stderr, "indexed %ld events, %d philosophers, %.3f ms of run "
+            "in %.3f ms\n", trace_count(r), g_n, (double)g_end / 1e6,
+            (double)(wall_ns() - t0) / 1e6);
+    trace_close(r);
+    return 0;
+}
+
+// ----- queries -----
+
+static void print_span(const span_t *s) {
+    printf("%12.6f - %12.6f ms  (%.6f ms%s)", (double)s->start / 1e6,
+           (double)s->end / 1e6, (double)span_len(s) / 1e6,
+           s->open ? ", open at end" : "");
+}
+
+// prints the spans of s overlapping [t1, t2]; returns how many
+static long print_window(const spans_t *s, long long t1, long long t2,
+                         int as_state) {
+    long lo = spans_first(s, t1), hi = spans_last(s, t2);
+    for (long i = lo; i < hi; i++) {
+        printf("  ");
+        if (as_state) printf("%-9s", state_names[s->v[i].who]);
+        else printf("%c", 'A' + s->v[i].who);
+        printf("  ");
+        print_span(&s->v[i]);
+        printf("\n");
+    }
+    return hi > lo ? hi - lo : 0;
+}
+
+static void query_holder(int fork, long long t1, long long t2) {
+    printf("fork %d:\n", fork);
+    if (print_window(&g_forks[fork], t1, t2, 0) == 0) printf("  not held\n");
+}
+
+static void query_state(int p, long long t1, long long t2) {
+    printf("%c:\n", 'A' + p);
+    print_window(&g_states[p], t1, t2, 1);
+}
+
+static void query_hungry(int p, long long t1, long long t2) {
+    const spans_t *h = &g_hungry[p];
+    long lo = spans_first(h, t1), hi = spans_last(h, t2);
+    if (lo >= hi) {
+        printf("%c: never hungry\n", 'A' + p);
+        return;
+    }
+    // the edge spans may stick out of the window; clip them, the ones
+    // between lie inside it
+    long best = -1;
+    long long best_len = -1;
+    long edges[2] = { lo, hi - 1 };
+    for (int k = 0; k < 2; k++) {
+        const span_t *s = &h->v[edges[k]];
+        long long a = s->start > t1 ? s->start : t1;
+        long long b = s->end < t2 ? s->end : t2;
+        if (b - a > best_len) best = edges[k], best_len = b - a;
+    }
+    if (hi - lo > 2) {
+        long mid = best_in(p, lo + 1, hi - 1);
+        if (span_len(&h->v[mid]) > best_len) {
+            best = mid;
+            best_len = span_len(&h->v[mid]);
+        }
+    }
+    printf("%c: longest hungry %.6f ms of %ld stretches\n  ", 'A' + p,
+           (double)best_len / 1e6, hi - lo);
+    print_span(&h->v[best]);
+    printf("\n");
+}
+
+static void query_eaters(int k, long long t1, long long t2) {
+    const spans_t *s = &g_eaters[k];
+    long lo = spans_first(s, t1), hi = spans_last(s, t2);
+    long long total = 0;
+    printf("at least %d eating:\n", k);
+    for (long i = lo; i < hi; i++) {
+        long long a = s->v[i].start > t1 ? s->v[i].start : t1;
+        long long b = s->v[i].end < t2 ? s->v[i].end : t2;
+        total += b - a;
+        printf("  ");
+        print_span(&s->v[i]);
+        printf("\n");
+    }
+    printf("  %ld stretches, %.6f ms\n", hi > lo ? hi - lo : 0,
+           (double)total / 1e6);
+}
+
+// ----- parsing -----
+
+// ns, or with a unit suffix us, ms or s
+static int parse_time(const char *str, long long *out) {
+    char *end = NULL;
+    errno = 0;
+    double v = strtod(str, &end);
+    if (errno || end == str || v < 0) return -1;
+    double scale = 1;
+    if (strcmp(end, "us") == 0) scale = 1e3;
+    else if (strcmp(end, "ms") == 0) scale = 1e6;
+    else if (strcmp(end, "s") == 0) scale = 1e9;
+    else if (*end != '\0' && strcmp(end, "ns") != 0) return -1;
+    if (v * scale > (double)LLONG_MAX / 2) return -1;
+    *out = (long long)(v * scale);
+    return 0;
+}
+
+static int parse_num(const char *str, long lo, long hi, long *out) {
+    char *end = NULL;
+    errno = 0;
+    long val = strtol(str, &end, 10);
+    if (errno || end == str || *end != '\0' || val < lo || val > hi) {
+        return -1;
+    }
+    *out = val;
+    return 0;
+}
+
+// a letter from A, or a number
+static int parse_phil(const char *str, long *out) {
+    if (str[0] >= 'A' && str[0] < 'A' + g_n && str[1] == '\0') {
+        *out = str[0] - 'A';
+        return 0;
+    }
+    return parse_num(str, 0, g_n - 1, out);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s TRACE [QUERY]\n"
+        "  holder FORK [T1 T2]    who held a fork\n"
+        "  state PHIL [T1 T2]     what a philosopher was doing\n"
+        "  hungry PHIL [T1 T2]    a philosopher's longest hungry stretch\n"
+        "  eaters K [T1 T2]       stretches with at least K eating\n"
+        "Times are ns, or take a us, ms or s suffix; a single time T\n"
+        "asks about that moment. Without a QUERY, reads queries from "
+        "stdin.\n",
+        prog);
+}
+
+// runs one query; 0 on success
+static int run_query(int argc, char **argv) {
+    if (argc < 2 || argc > 4) return -1;
+    long long t1 = 0, t2 = LLONG_MAX;
+    if (argc >= 3 && parse_time(argv[2], &t1) != 0) return -1;
+    t2 = argc >= 3 ? t1 : t2;
+    if (argc == 4 && (parse_time(argv[3], &t2) != 0 || t2 < t1)) return -1;
+
+    long v = 0;
+    if (strcmp(argv[0], "holder") == 0) {
+        if (parse_num(argv[1], 0, g_n - 1, &v) != 0) return -1;
+        query_holder((int)v, t1, t2);
+    } else if (strcmp(argv[0], "state") == 0) {
+        if (parse_phil(argv[1], &v) != 0) return -1;
+        query_state((int)v, t1, t2);
+    } else if (strcmp(argv[0], "hungry") == 0) {
+        if (parse_phil(argv[1], &v) != 0) return -1;
+        query_hungry((int)v, t1, t2);
+    } else if (strcmp(argv[0], "eaters") == 0) {
+        if (parse_num(argv[1], 1, g_n, &v) != 0) return -1;
+        query_eaters((int)v, t1, t2);
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || strcmp(argv[1], "--help") == 0) {
+        usage(argv[0]);
+        return argc < 2 ? 1 : 0;
+    }
+    if (build_index(argv[1]) != 0) return 1;
+
+    if (argc > 2) {
+        if (run_query(argc - 2, argv + 2) != 0) {
+            usage(argv[0]);
+            return 1;
+        }
+        return 0;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof line, stdin) != NULL) {
+        char *words[5];
+        int count = 0;
+        for (char *w = strtok(line, " \t\n"); w != NULL && count < 5;
+             w = strtok(NULL, " \t\n")) {
+            words[count++] = w;
+        }
+        if (count == 0) continue;
+        if (run_query(count, words) != 0) {
+            fprintf(stderr, "bad query; try: holder 3 10ms 20ms, hungry C, "
+                    "eaters 2\n");
+        }
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -1,16 +1,42 @@
 // dine.c
+#ifdef __linux__
+#define _GNU_SOURCE     // CPU affinity for --pin
+#endif
 #define _POSIX_C_SOURCE 200809L
 
 #include <errno.h>
 #include <limits.h>
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <sched.h>
 #include <semaphore.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include <time.h>
 #include <sys/time.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+#include "trace.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+#ifdef __linux__
+#include <linux/futex.h>
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#if defined(__has_include)
+#if __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#define HAVE_RSEQ 1
+#endif
+#endif
+#endif
 
 #ifndef NUM_PHILOSOPHERS
 #define NUM_PHILOSOPHERS 5
@@ -34,45 +60,17 @@ typedef struct {
     int left_fork;   // fork index (same as id)
     int right_fork;  // (id+1)%N
     int cycles;      // remaining eat/think cycles
+    long meals;      // meals eaten this run
 }
 phil_arg_t;
 
-static sem_t forks_unnamed[NUM_PHILOSOPHERS];
-
-static void forks_init_all(void) {
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        if (sem_init(&forks_unnamed[i], 0, 1) == -1) {
-            perror("sem_init");
-            exit(1);
-        }
-    }
-}
-
-static void forks_destroy_all(void) {
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        if (sem_destroy(&forks_unnamed[i]) == -1) {
-            perror("sem_destroy");
-        }
-    }
-}
-
-static void fork_wait_idx(int idx) {
-    while (sem_wait(&forks_unnamed[idx]) == -1 && errno == EINTR) {}
-}
-
-static void fork_post_idx(int idx) {
-    if (sem_post(&forks_unnamed[idx]) == -1) {
-        perror("sem_post");
-        exit(1);
-    }
-}
-
 // global variables
 static pthread_t tids[NUM_PHILOSOPHERS];
 static phil_arg_t args[NUM_PHILOSOPHERS];
 static pthread_mutex_t print_mtx = PTHREAD_MUTEX_INITIALIZER;
 
 // for status display
+static int g_quiet;     // suppress the table (used by non-interactive modes)
 static state_t g_state[NUM_PHILOSOPHERS];
 static int g_hold_left[NUM_PHILOSOPHERS];
 static int g_hold_right[NUM_PHILOSOPHERS];
@@ -84,279 +82,4688 @@ static void die_errno(const char *msg, int err) {
     exit(1);
 }
 
-// causes the philosopher to pause for a random
-// amount of time between 0 and DAWDLEFACTOR milliseconds
-static void dawdle(void) {
-    // sleep for 0..DAWDLEFACTOR ms
-    struct timespec tv;
-    long ms = random() % (DAWDLEFACTOR + 1);
-    tv.tv_sec = ms / 1000;
-    tv.tv_nsec = (ms % 1000) * 1000000L;
-    if (nanosleep(&tv, NULL) == -1) {
-        perror("nanosleep");
+// parses a whole decimal argument in [lo, hi]; returns 0 on success
+static int parse_num(const char *str, long lo, long hi, long *out) {
+    char *end = NULL;
+    errno = 0;
+    long val = strtol(str, &end, 10);
+    if (errno || end == str || *end != '\0' || val < lo || val > hi) {
+        return -1;
     }
+    *out = val;
+    return 0;
 }
 
-static char label_for(int i) {
-    // start at 'A' and continue up the ASCII table
-    return (char)('A' + i);
+// CLOCK_MONOTONIC in nanoseconds (a vDSO call, no syscall, on Linux)
+static long long os_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
 }
 
-// build a forks string per column of length NUM_PHILOSOPHERS,
-// marking only the forks held by this philosopher with their index digit
-// and '-' elsewhere
-static void build_fork_str(int pid, char *buf, size_t buflen) {
-    // display dashes '-'
-    for (int i = 0; i < NUM_PHILOSOPHERS && (size_t)i < buflen - 1; i++) {
-        buf[i] = '-';
-    }
-    // null terminate
-    if (NUM_PHILOSOPHERS < (int)buflen - 1) {
-        buf[NUM_PHILOSOPHERS] = '\0';
-    }
-    else {
-        buf[buflen - 1] = '\0';
-    }
+// With an invariant TSC (constant rate, runs through idle states) now_ns
+// reads the TSC and scales it by a rate calibrated against the OS clock
+// at startup; otherwise, or with --no-tsc, it asks the OS clock.
+static int g_tsc;                   // now_ns uses the TSC
+static double g_tsc_ns_per_tick;
+static unsigned long long g_tsc_base;
+static long long g_tsc_base_ns;
 
-    int lf = args[pid].left_fork;
-    int rf = args[pid].right_fork;
+static inline unsigned long long tsc_read(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
 
-    if (g_hold_left[pid]) {
-        buf[lf] = (char)('0' + (lf % 10));
-    }
-    if (g_hold_right[pid]) {
-        buf[rf] = (char)('0' + (rf % 10));
-    }
+static int tsc_invariant(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned a, b, c, d;
+    if (!__get_cpuid(0x80000000, &a, &b, &c, &d) || a < 0x80000007) return 0;
+    __get_cpuid(0x80000007, &a, &b, &c, &d);
+    return (d >> 8) & 1;
+#else
+    return 0;
+#endif
 }
 
-static const char* state_suffix(state_t s) {
-    switch (s) {
-        case ST_EATING:   return " Eat";
-        case ST_THINKING: return " Think";
-        default:          return " ";
+// monotonic clock in nanoseconds
+static inline long long now_ns(void) {
+    if (g_tsc) {
+        // signed: another core's TSC may read a little behind the base
+        long long ticks = (long long)(tsc_read() - g_tsc_base);
+        return g_tsc_base_ns + (long long)((double)ticks * g_tsc_ns_per_tick);
     }
+    return os_clock_ns();
 }
 
-// internal printer: caller must hold print_mtx
-static void print_status_locked(void) {
-    char fbuf[NUM_PHILOSOPHERS + 1];
-    printf("| ");
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        build_fork_str(i, fbuf, sizeof fbuf);
-        const char *suf = state_suffix(g_state[i]);
-        // show fork string + " Eat"/" Think", blank for changing
-        // align columns for neatness
-        printf("%-5s%-7s| ", fbuf, suf);
-    }
-    printf("\n");
+// picks the clock; call before any thread starts
+static void clock_init(int allow_tsc) {
+    if (!allow_tsc || !tsc_invariant()) return;
+    const struct timespec span = { 0, 20000000 };
+    long long ns0 = os_clock_ns();
+    unsigned long long t0 = tsc_read();
+    nanosleep(&span, NULL);
+    long long ns1 = os_clock_ns();
+    unsigned long long t1 = tsc_read();
+    if (t1 <= t0 || ns1 <= ns0) return;
+    g_tsc_ns_per_tick = (double)(ns1 - ns0) / (double)(t1 - t0);
+    g_tsc_base = t1;
+    g_tsc_base_ns = ns1;
+    g_tsc = 1;
 }
 
-// print header once at start
-static void print_header(void) {
-    pthread_mutex_lock(&print_mtx);
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
 
-    // print top border line
-    printf("|");
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        printf("=============|");
+// sleeps for ms milliseconds
+static void sleep_ms(long ms) {
+    struct timespec tv = { ms / 1000, (ms % 1000) * 1000000L };
+    // a trace signal lands in any thread: sleep out the rest
+    while (nanosleep(&tv, &tv) == -1) {
+        if (errno != EINTR) {
+            perror("nanosleep");
+            break;
+        }
     }
-    printf("\n| ");
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        printf("%c           | ", label_for(i));
+}
+
+// ----- tunables -----
+// knobs picked by hand (--strategy, --backend, ...), loaded with
+// --config FILE, or searched for by --autotune
+enum { STRAT_PARITY, STRAT_ORDERED, STRAT_WAITER };  // strategies[] order
+enum { FORK_SEM, FORK_SPIN, FORK_HANDOFF, FORK_TICKET, FORK_BIASED,
+       NUM_BACKENDS };
+enum { PIN_NONE, PIN_COMPACT };
+
+typedef struct {
+    int strategy;      // index into strategies[]
+    int backend;       // FORK_*: how a fork wait blocks
+    int spin_limit;    // FORK_SPIN: try-acquires before blocking
+    int backoff_max;   // FORK_SPIN: cap on the doubling pause between tries
+    int pin;           // PIN_*: CPU affinity of philosopher threads
+}
+tune_t;
+
+static const char *const backend_names[] = { "sem", "spin", "handoff",
+                                               "ticket", "biased" };
+static const char *const pin_names[] = { "none", "compact" };
+
+static tune_t g_tune = { 0, FORK_SEM, 100, 64, PIN_NONE };
+static long g_dawdle_ms = DAWDLEFACTOR;  // --dawdle: max think/eat time
+static long g_duration_ms;               // --duration: run for a fixed time
+// lock coarsening: after a meal keep both forks for up to g_batch meals
+// while no neighbor waits on them, and for g_batch_ms even if one does
+static long g_batch = 1;            // --batch K
+static long g_batch_ms;             // --batch-ms MS
+static atomic_int g_stop;                // timed run is over
+
+static int name_index(const char *const *names, int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(names[i], name) == 0) return i;
     }
-    printf("\n|");
+    return -1;
+}
+
+// one pause step of a spin-wait
+static void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#else
+    sched_yield();
+#endif
+}
+
+// binds the calling philosopher to a CPU according to g_tune.pin
+static void pin_self(int pid) {
+#ifdef __linux__
+    if (g_tune.pin != PIN_COMPACT) return;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu <= 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET((int)(pid % ncpu), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof set, &set);
+#else
+    (void)pid;
+#endif
+}
+
+// ----- philosopher profiles -----
+// --table FILE gives philosophers their own eat/think times, cycle
+// counts and priorities. One line per philosopher (or '*' for all),
+// later lines overriding earlier ones:
+//     * think=exp:20
+//     A eat=uniform:5:50 cycles=10 priority=3
+// Times are fixed:MS, uniform:LO:HI or exp:MEAN, each number in
+// --dawdle's range; unset ones keep the uniform 0..--dawdle default.
+// Priority weights hungry time under --max-hungry.
+enum { DIST_DEFAULT, DIST_FIXED, DIST_UNIFORM, DIST_EXP };
+
+typedef struct {
+    int kind;           // DIST_*
+    long a, b;          // fixed a / uniform a..b / exponential mean a
+}
+dist_t;
+
+typedef struct {
+    dist_t eat, think;
+    long cycles;        // 0: the command line's count
+    long priority;
+}
+profile_t;
+
+static profile_t g_profile[NUM_PHILOSOPHERS];
+
+static void profiles_init(void) {
     for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        printf("=============|");
+        g_profile[i] = (profile_t){ { DIST_DEFAULT, 0, 0 },
+                                    { DIST_DEFAULT, 0, 0 }, 0, 1 };
     }
-    printf("\n");
+}
 
-    char fbuf[NUM_PHILOSOPHERS + 1];
-    printf("| ");
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        build_fork_str(i, fbuf, sizeof fbuf);
-        printf("%-5s%-7s| ", fbuf, "");
+// one draw from d, in milliseconds
+static long dist_draw(const dist_t *d) {
+    switch (d->kind) {
+        case DIST_FIXED:   return d->a;
+        case DIST_UNIFORM: return d->a + random() % (d->b - d->a + 1);
+        case DIST_EXP: {
+            // the tail is capped where --dawdle is
+            double u = ((double)random() + 1.0) / ((double)RAND_MAX + 2.0);
+            double ms = -(double)d->a * log(u) + 0.5;
+            return ms < INT_MAX / 2 ? (long)ms : INT_MAX / 2;
+        }
+        default:           return random() % (g_dawdle_ms + 1);
     }
-    printf("\n");
-    pthread_mutex_unlock(&print_mtx);
 }
 
-// ----- philosopher functions ------
+static int dist_parse(const char *val, dist_t *d) {
+    char kind[64];
+    if (strlen(val) >= sizeof kind) return -1;
+    strcpy(kind, val);
+    char *a = strchr(kind, ':');
+    if (a == NULL) return -1;
+    *a++ = '\0';
+    char *b = strchr(a, ':');
+    if (b != NULL) *b++ = '\0';
+    if (parse_num(a, 0, INT_MAX / 2, &d->a) != 0) return -1;
 
-// picks up the philosopher's first fork based on the specified order
-static void pick_first_fork(int pid, int first_is_left) {
-    int fork_idx;
-    if (first_is_left) {
-        fork_idx = args[pid].left_fork;
+    if (strcmp(kind, "uniform") == 0) {
+        if (b == NULL || parse_num(b, d->a, INT_MAX / 2, &d->b) != 0) return -1;
+        d->kind = DIST_UNIFORM;
+    } else if (b != NULL) {
+        return -1;
+    } else if (strcmp(kind, "fixed") == 0) {
+        d->kind = DIST_FIXED;
+    } else if (strcmp(kind, "exp") == 0) {
+        d->kind = DIST_EXP;
     } else {
-        fork_idx = args[pid].right_fork;
+        return -1;
     }
+    return 0;
+}
 
-    // wait
-    fork_wait_idx(fork_idx);
+static int profile_set(profile_t *p, const char *key, const char *val) {
+    if (strcmp(key, "eat") == 0) return dist_parse(val, &p->eat);
+    if (strcmp(key, "think") == 0) return dist_parse(val, &p->think);
+    if (strcmp(key, "cycles") == 0) return parse_num(val, 1, INT_MAX, &p->cycles);
+    if (strcmp(key, "priority") == 0) {
+        return parse_num(val, 1, 1000, &p->priority);
+    }
+    return -1;
+}
 
-    // update + print atomically (one change per line)
-    pthread_mutex_lock(&print_mtx);
-    if (first_is_left) {
-        g_hold_left[pid] = 1;
-    } else {
-        g_hold_right[pid] = 1;
+static int profiles_load(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror(path);
+        return -1;
     }
-    print_status_locked();
-    pthread_mutex_unlock(&print_mtx);
+    char line[256];
+    int rc = 0;
+    while (rc == 0 && fgets(line, sizeof line, fp) != NULL) {
+        line[strcspn(line, "#\r\n")] = '\0';
+        char *save = NULL;
+        char *who = strtok_r(line, " \t", &save);
+        if (who == NULL) continue;
+        int lo = 0, hi = NUM_PHILOSOPHERS - 1;
+        if (strcmp(who, "*") != 0) {
+            lo = hi = who[0] - 'A';
+            if (who[1] != '\0' || lo < 0 || lo >= NUM_PHILOSOPHERS) rc = -1;
+        }
+        char *tok;
+        while (rc == 0 && (tok = strtok_r(NULL, " \t", &save)) != NULL) {
+            char *eq = strchr(tok, '=');
+            if (eq == NULL) {
+                rc = -1;
+                break;
+            }
+            *eq = '\0';
+            for (int i = lo; i <= hi && rc == 0; i++) {
+                rc = profile_set(&g_profile[i], tok, eq + 1);
+            }
+        }
+        if (rc != 0) fprintf(stderr, "%s: bad line for %s\n", path, who);
+    }
+    fclose(fp);
+    return rc;
 }
 
-// picks up the philosopher's second fork
-static void pick_second_fork(int pid, int first_is_left) {
-    int fork_idx;
-    if (first_is_left) {
-        fork_idx = args[pid].right_fork;
-    } else {
-        fork_idx = args[pid].left_fork;
+// ----- statistics -----
+static int g_stats;                 // --stats: print a summary after the run
+static long long g_run_start;       // wall time the threads were started
+static long long g_run_end;         // wall time the last thread was joined
+
+// table-wide meal count and hungry wait, sharded per CPU: the CPU
+// number comes from the rseq area glibc registers for every thread (one
+// load, no syscall), and the add lands on that CPU's own cache line.
+// Without rseq each thread counts into the shard of its id. args[].meals
+// keeps the per-philosopher counts.
+#define MEAL_SHARDS 64
+
+typedef struct {
+    _Alignas(64) atomic_long n;
+    atomic_llong wait_ns;   // summed hungry time (--stats)
+}
+meal_shard_t;
+
+static meal_shard_t g_meal_shards[MEAL_SHARDS];
+
+// the CPU this thread is on, from its rseq area; -1 if unavailable
+static inline int rseq_cpu(void) {
+#ifdef HAVE_RSEQ
+    if (__rseq_size > 0) {
+        const struct rseq *rs = (const struct rseq *)
+            ((const char *)__builtin_thread_pointer() + __rseq_offset);
+        int cpu = (int)*(volatile const unsigned *)&rs->cpu_id;
+        if (cpu >= 0) return cpu;
     }
+#endif
+    return -1;
+}
 
-    fork_wait_idx(fork_idx);
+static inline int meal_shard(int tid) {
+    int cpu = rseq_cpu();
+    return (cpu >= 0 ? cpu : tid) % MEAL_SHARDS;
+}
 
-    pthread_mutex_lock(&print_mtx);
-    if (first_is_left) {
-        g_hold_right[pid] = 1;
-    } else {
-        g_hold_left[pid] = 1;
+static inline void meals_add(int tid) {
+    atomic_fetch_add_explicit(&g_meal_shards[meal_shard(tid)].n, 1,
+                              memory_order_relaxed);
+}
+
+static inline void wait_add(int tid, long long ns) {
+    atomic_fetch_add_explicit(&g_meal_shards[meal_shard(tid)].wait_ns, ns,
+                              memory_order_relaxed);
+}
+
+static long long wait_total(void) {
+    long long sum = 0;
+    for (int i = 0; i < MEAL_SHARDS; i++) {
+        sum += atomic_load_explicit(&g_meal_shards[i].wait_ns,
+                                    memory_order_relaxed);
     }
-    print_status_locked();
-    pthread_mutex_unlock(&print_mtx);
+    return sum;
 }
 
-// releases one of the philosopher's forks
-static void put_down_one_fork(int pid, int left) {
-    int fork_idx;
-    pthread_mutex_lock(&print_mtx);
-    if (left) {
-        fork_idx = args[pid].left_fork;
-        g_hold_left[pid] = 0;
-    } else {
-        fork_idx = args[pid].right_fork;
-        g_hold_right[pid] = 0;
+static long meals_total(void) {
+    long sum = 0;
+    for (int i = 0; i < MEAL_SHARDS; i++) {
+        sum += atomic_load_explicit(&g_meal_shards[i].n, memory_order_relaxed);
     }
-    print_status_locked();
-    pthread_mutex_unlock(&print_mtx);
+    return sum;
+}
 
-    // post
-    fork_post_idx(fork_idx);
+static void meals_reset(void) {
+    for (int i = 0; i < MEAL_SHARDS; i++) {
+        atomic_store(&g_meal_shards[i].n, 0);
+        atomic_store(&g_meal_shards[i].wait_ns, 0);
+    }
 }
 
-static void *philosopher(void *vp) {
-    phil_arg_t *p = (phil_arg_t*)vp;
-    int id = p->id;
+// per-fork usage; only the current holder of a fork touches its record
+typedef struct {
+    long acquisitions;
+    long long wait_ns;      // summed time from wait to grant
+    long long held_ns;      // summed time from grant to post
+    long long held_since;
+}
+fork_stat_t;
 
-    const int even = (id % 2 == 0);
+static fork_stat_t g_fork_stats[NUM_PHILOSOPHERS];
+static const char *g_heatmap_path;  // --heatmap FILE: per-fork CSV
 
-    // odd/even strategy to avoid deadlock:
-    // even picks RIGHT first, odd picks LEFT first
-    // even -> right first; odd -> left first
-    while (p->cycles > 0) {
-        // ---- acquire forks (changing) ----
-        pthread_mutex_lock(&print_mtx);
-        g_state[id] = ST_CHANGING;
-        print_status_locked();
-        pthread_mutex_unlock(&print_mtx);
+// number of philosophers currently in ST_EATING, and how long the table
+// spent with each count (index k = k simultaneous eaters)
+static atomic_int g_eaters;
+static long long g_eaters_ns[NUM_PHILOSOPHERS + 1];
+static long long g_eaters_since;
 
-        pick_first_fork(id, !even);
-        pick_second_fork(id, !even);
+// adjusts the eater count and integrates the previous count over the
+// time it was in effect: caller must hold print_mtx
+static void eaters_change_locked(int delta) {
+    int old = atomic_fetch_add(&g_eaters, delta);
+    if (!g_stats) return;
+    long long now = now_ns();
+    g_eaters_ns[old] += now - g_eaters_since;
+    g_eaters_since = now;
+}
 
-        // ---- eat ----
-        pthread_mutex_lock(&print_mtx);
-        g_state[id] = ST_EATING;
-        print_status_locked();
-        pthread_mutex_unlock(&print_mtx);
-        dawdle();
+// time-weighted concurrency against the floor(N/2) possible eaters
+static void print_concurrency_report(void) {
+    const int max = NUM_PHILOSOPHERS / 2;
+    long long total = 0;
+    double weighted = 0.0;
+    for (int k = 0; k <= NUM_PHILOSOPHERS; k++) {
+        total += g_eaters_ns[k];
+        weighted += (double)k * (double)g_eaters_ns[k];
+    }
+    if (total <= 0) return;
 
-        // ---- transition to set forks down ----
-        pthread_mutex_lock(&print_mtx);
-        g_state[id] = ST_CHANGING;
-        print_status_locked();
-        pthread_mutex_unlock(&print_mtx);
+    double avg = weighted / (double)total;
+    printf("concurrency: %.3f eaters on average of %d possible (%.1f%%)\n",
+           avg, max, max > 0 ? 100.0 * avg / max : 0.0);
+    for (int k = 0; k <= NUM_PHILOSOPHERS; k++) {
+        if (k > max && g_eaters_ns[k] == 0) continue;
+        double pct = 100.0 * (double)g_eaters_ns[k] / (double)total;
+        printf("  %2d eating %5.1f%% ", k, pct);
+        for (int j = 0; j < (int)(pct / 2.0 + 0.5); j++) putchar('#');
+        printf("\n");
+    }
+}
 
-        // put down one at a time
-        put_down_one_fork(id, !even);
-        put_down_one_fork(id,  even);
+// hungry latency (start of acquiring to eating), kept per philosopher in
+// constant space however many meals there are: a running mean and
+// variance (Welford) and a DDSketch of the distribution. The sketch
+// counts each value into the log-spaced bucket ceil(log_gamma(ns)), so
+// any quantile it reports is within 1% of the true one. Only the owner
+// writes its sketch; reports merge them after the threads are joined.
+#define LAT_ALPHA 0.01                      // relative accuracy
+#define LAT_LOG_GAMMA 0.020000666706669435  // ln((1 + a) / (1 - a))
+#define LAT_BUCKETS 2200                    // reaches past 2^63 ns
 
-        // think
-        pthread_mutex_lock(&print_mtx);
-        g_state[id] = ST_THINKING;
-        print_status_locked();
-        pthread_mutex_unlock(&print_mtx);
-        dawdle();
+typedef struct {
+    _Alignas(64) long count;
+    double mean, m2;                        // Welford
+    long long max;
+    long bucket[LAT_BUCKETS];               // bucket 0: 1 ns and under
+}
+lat_sketch_t;
 
-        // prepare next cycle
-        p->cycles--;
-    }
+static int g_latency;               // keep the sketches (--stats, --batch-sweep)
+static lat_sketch_t g_hungry[NUM_PHILOSOPHERS];
 
-    // transition from thinking to terminated counts as changing
-    pthread_mutex_lock(&print_mtx);
-    g_state[id] = ST_CHANGING;
-    print_status_locked();
-    pthread_mutex_unlock(&print_mtx);
-    return NULL;
+static void lat_record(int pid, long long ns) {
+    lat_sketch_t *l = &g_hungry[pid];
+    l->count++;
+    double delta = (double)ns - l->mean;
+    l->mean += delta / (double)l->count;
+    l->m2 += delta * ((double)ns - l->mean);
+    if (ns > l->max) l->max = ns;
+
+    int k = ns > 1 ? (int)ceil(log((double)ns) / LAT_LOG_GAMMA) : 0;
+    l->bucket[k < LAT_BUCKETS ? k : LAT_BUCKETS - 1]++;
 }
 
-// ----- main -----
-int main(int argc, char **argv) {
-    struct timeval tv;
-    if (gettimeofday(&tv, NULL) == -1) {
-        perror("gettimeofday");
-        return 1;
-    }
-    srandom((unsigned)(tv.tv_sec ^ tv.tv_usec));
+static void lat_reset(void) {
+    memset(g_hungry, 0, sizeof g_hungry);
+}
 
-    // parse optional cycles argument
-    long cycles = 1;
-    if (argc >= 2) {
-        char *end = NULL;
-        errno = 0;
-        long val = strtol(argv[1], &end, 10);
-        if (errno || end == argv[1] || val <= 0 || val > INT_MAX) {
-            fprintf(stderr, "Usage: %s [positive cycles]\n", argv[0]);
-            return 1;
-        }
-        cycles = val;
+// folds b into a: bucket counts add, mean and m2 combine (Chan et al.)
+static void lat_merge(lat_sketch_t *a, const lat_sketch_t *b) {
+    if (b->count == 0) return;
+    long n = a->count + b->count;
+    double delta = b->mean - a->mean;
+    a->m2 += b->m2 + delta * delta * (double)a->count * (double)b->count
+             / (double)n;
+    a->mean += delta * (double)b->count / (double)n;
+    a->count = n;
+    if (b->max > a->max) a->max = b->max;
+    for (int k = 0; k < LAT_BUCKETS; k++) a->bucket[k] += b->bucket[k];
+}
+
+// the value of rank `rank` (0-based) in the sketch, in ns
+static double lat_quantile_ns(const lat_sketch_t *l, long rank) {
+    long seen = 0;
+    for (int k = 0; k < LAT_BUCKETS; k++) {
+        seen += l->bucket[k];
+        if (seen <= rank) continue;
+        // 2 gamma^k / (gamma + 1): within alpha of anything in the bucket
+        double v = k == 0 ? 1.0 : exp(k * LAT_LOG_GAMMA) * (1.0 - LAT_ALPHA);
+        return v < (double)l->max ? v : (double)l->max;
     }
+    return (double)l->max;
+}
 
-    // init shared state
+typedef struct {
+    size_t count;
+    double mean_ms, sd_ms, p50_ms, p99_ms, max_ms;
+}
+lat_summary_t;
+
+// merges n sketches; call with the threads joined
+static lat_summary_t lat_summarize_sketches(const lat_sketch_t *sk, int n) {
+    lat_summary_t sum = { 0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+    static lat_sketch_t all;        // too big for the stack; main only
+    memset(&all, 0, sizeof all);
+    for (int i = 0; i < n; i++) lat_merge(&all, &sk[i]);
+    if (all.count == 0) return sum;
+
+    sum.count = (size_t)all.count;
+    sum.mean_ms = all.mean / 1e6;
+    sum.sd_ms = all.count > 1
+        ? sqrt(all.m2 / (double)(all.count - 1)) / 1e6 : 0.0;
+    sum.p50_ms = lat_quantile_ns(&all, all.count / 2) / 1e6;
+    sum.p99_ms = lat_quantile_ns(&all, all.count * 99 / 100) / 1e6;
+    sum.max_ms = (double)all.max / 1e6;
+    return sum;
+}
+
+static lat_summary_t lat_summarize(void) {
+    return lat_summarize_sketches(g_hungry, NUM_PHILOSOPHERS);
+}
+
+static void print_latency_report(void) {
+    lat_summary_t s = lat_summarize();
+    if (s.count == 0) return;
+    printf("hungry: mean %.3f ms (sd %.3f), p50 %.3f ms, p99 %.3f ms, "
+           "max %.3f ms over %zu acquisitions\n",
+           s.mean_ms, s.sd_ms, s.p50_ms, s.p99_ms, s.max_ms, s.count);
+}
+
+// per-philosopher hungry time, and Jain's index over the meal counts
+// (1.0 = everyone ate equally, 1/N = one philosopher ate everything)
+static void print_philosopher_report(void) {
+    double sum = 0.0, sq = 0.0;
+    printf("philosophers:\n");
     for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        g_state[i] = ST_CHANGING;
-        g_hold_left[i] = 0;
-        g_hold_right[i] = 0;
+        lat_summary_t s = lat_summarize_sketches(&g_hungry[i], 1);
+        double m = (double)args[i].meals;
+        sum += m;
+        sq += m * m;
+        printf("  %c meals %7ld  hungry mean %8.3f ms  p99 %8.3f ms  "
+               "max %8.3f ms\n", 'A' + i, args[i].meals, s.mean_ms,
+               s.p99_ms, s.max_ms);
     }
+    if (sq > 0) {
+        printf("  fairness (Jain) %.4f\n", sum * sum / (NUM_PHILOSOPHERS * sq));
+    }
+}
 
-    // init semaphores (forks)
-    forks_init_all();
-
-    print_header();
+// per-fork utilization across the ring; queue depth is the time-averaged
+// number of philosophers waiting for or holding the fork (Little's law)
+static void print_fork_report(void) {
+    static const char ramp[] = " .:-=+*#%@";
+    const double wall = (double)(g_run_end - g_run_start);
+    if (wall <= 0) return;
 
-    // create threads
+    printf("forks:\n");
     for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        args[i].id = i;
-        args[i].left_fork  = i;
-        args[i].right_fork = (i + 1) % NUM_PHILOSOPHERS;
-        args[i].cycles = (int)cycles;
+        const fork_stat_t *fs = &g_fork_stats[i];
+        double held = (double)fs->held_ns / wall;
+        double depth = (double)(fs->wait_ns + fs->held_ns) / wall;
+        printf("  %2d held %5.1f%%  acq %6ld  queue %5.2f  |", i,
+               100.0 * held, fs->acquisitions, depth);
+        for (int j = 0; j < 20; j++) {
+            putchar(j < (int)(held * 20.0 + 0.5) ? '#' : ' ');
+        }
+        printf("|\n");
+    }
 
-        int rc = pthread_create(&tids[i], NULL, philosopher, &args[i]);
-        if (rc != 0) die_errno("pthread_create", rc);
+    // one character per fork, darker = held longer
+    printf("  heat [");
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        double held = (double)g_fork_stats[i].held_ns / wall;
+        int lvl = (int)(held * (double)(sizeof ramp - 2) + 0.5);
+        putchar(ramp[lvl]);
     }
+    printf("]\n");
+}
 
-    // join threads
+static void write_fork_csv(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        perror(path);
+        return;
+    }
+    const double wall = (double)(g_run_end - g_run_start);
+    fprintf(fp, "fork,held_frac,acquisitions,avg_queue_depth,avg_wait_ms\n");
     for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
-        int rc = pthread_join(tids[i], NULL);
-        if (rc != 0) die_errno("pthread_join", rc);
+        const fork_stat_t *fs = &g_fork_stats[i];
+        fprintf(fp, "%d,%.6f,%ld,%.6f,%.3f\n", i,
+                wall > 0 ? (double)fs->held_ns / wall : 0.0,
+                fs->acquisitions,
+                wall > 0 ? (double)(fs->wait_ns + fs->held_ns) / wall : 0.0,
+                fs->acquisitions
+                    ? (double)fs->wait_ns / (double)fs->acquisitions / 1e6
+                    : 0.0);
     }
+    if (fclose(fp) == EOF) perror(path);
+}
 
-    // bottom border
-    pthread_mutex_lock(&print_mtx);
-    printf("|");
-    for (int i = 0; i < NUM_PHILOSOPHERS; i++) printf("=============|");
-    printf("\n");
+// ----- schedule record/replay -----
+// --record logs every fork grant (in grant order) and every sampled
+// dawdle duration; --replay feeds the durations back and holds each
+// fork_wait_idx() at a sequencing gate until its grant is next in the log
+typedef struct {
+    char kind;       // 'G' = fork granted, 'D' = dawdle duration
+    int pid;
+    long val;        // fork index or milliseconds
+}
+sched_ev_t;
+
+static const char *g_record_path;
+static const char *g_replay_path;
+static pthread_mutex_t sched_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sched_cv = PTHREAD_COND_INITIALIZER;
+static sched_ev_t *g_sched;
+static size_t g_sched_len, g_sched_cap;
+static size_t g_grant_next;                  // replay: next 'G' to hand out
+static size_t g_dawdle_next[NUM_PHILOSOPHERS]; // replay: per-pid 'D' cursor
+static long g_sched_cycles[NUM_PHILOSOPHERS];  // per-pid cycles ('P' lines)
+
+static void sched_append(char kind, int pid, long val) {
+    pthread_mutex_lock(&sched_mtx);
+    if (g_sched_len == g_sched_cap) {
+        size_t cap = g_sched_cap ? g_sched_cap * 2 : 1024;
+        sched_ev_t *p = realloc(g_sched, cap * sizeof *p);
+        if (p == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+        g_sched = p;
+        g_sched_cap = cap;
+    }
+    g_sched[g_sched_len++] = (sched_ev_t){ kind, pid, val };
+    pthread_mutex_unlock(&sched_mtx);
+}
+
+// cycles: the run's count; g_sched_cycles holds each philosopher's own,
+// which differs under --table
+static void sched_write(const char *path, long cycles) {
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        perror(path);
+        return;
+    }
+    fprintf(fp, "# dine schedule v2\nN %d\nC %ld\n", NUM_PHILOSOPHERS, cycles);
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        fprintf(fp, "P %d %ld\n", i, g_sched_cycles[i]);
+    }
+    for (size_t i = 0; i < g_sched_len; i++) {
+        fprintf(fp, "%c %d %ld\n", g_sched[i].kind, g_sched[i].pid,
+                g_sched[i].val);
+    }
+    if (fclose(fp) == EOF) perror(path);
+}
+
+// loads a recorded schedule into g_sched and g_sched_cycles (v1 files
+// have no 'P' lines: everyone gets the run's count); returns the run's
+// cycle count, or -1 on error
+static long sched_load(const char *path) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+    char line[128];
+    long n = -1, cycles = -1;
+    while (fgets(line, sizeof line, fp) != NULL) {
+        char kind;
+        int pid;
+        long val;
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (sscanf(line, "N %ld", &n) == 1) continue;
+        if (sscanf(line, "C %ld", &cycles) == 1) continue;
+        if (sscanf(line, "P %d %ld", &pid, &val) == 2 &&
+            pid >= 0 && pid < NUM_PHILOSOPHERS && val > 0 && val <= INT_MAX) {
+            g_sched_cycles[pid] = val;
+            continue;
+        }
+        if (sscanf(line, "%c %d %ld", &kind, &pid, &val) != 3 ||
+            (kind != 'G' && kind != 'D') ||
+            pid < 0 || pid >= NUM_PHILOSOPHERS) {
+            fprintf(stderr, "%s: bad line: %s", path, line);
+            fclose(fp);
+            return -1;
+        }
+        sched_append(kind, pid, val);
+    }
+    fclose(fp);
+    if (n != NUM_PHILOSOPHERS || cycles <= 0 || cycles > INT_MAX) {
+        fprintf(stderr, "%s: recorded for %ld philosophers, built for %d\n",
+                path, n, NUM_PHILOSOPHERS);
+        return -1;
+    }
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        if (g_sched_cycles[i] == 0) g_sched_cycles[i] = cycles;
+    }
+    return cycles;
+}
+
+// replay: blocks until granting fork idx to pid is next in the log
+static void replay_gate(int pid, int idx) {
+    pthread_mutex_lock(&sched_mtx);
+    for (;;) {
+        while (g_grant_next < g_sched_len && g_sched[g_grant_next].kind != 'G') {
+            g_grant_next++;
+        }
+        if (g_grant_next == g_sched_len) {
+            fprintf(stderr, "replay: schedule exhausted (%c waits for fork %d)\n",
+                    'A' + pid, idx);
+            exit(1);
+        }
+        const sched_ev_t *e = &g_sched[g_grant_next];
+        if (e->pid == pid && e->val == idx) break;
+        pthread_cond_wait(&sched_cv, &sched_mtx);
+    }
+    pthread_mutex_unlock(&sched_mtx);
+}
+
+// replay: the grant at the head of the log has happened
+static void replay_advance(void) {
+    pthread_mutex_lock(&sched_mtx);
+    g_grant_next++;
+    pthread_cond_broadcast(&sched_cv);
+    pthread_mutex_unlock(&sched_mtx);
+}
+
+// replay: next recorded duration for pid, or -1 when none is left
+static long replay_duration(int pid) {
+    long ms = -1;
+    pthread_mutex_lock(&sched_mtx);
+    size_t i = g_dawdle_next[pid];
+    while (i < g_sched_len && !(g_sched[i].kind == 'D' && g_sched[i].pid == pid)) {
+        i++;
+    }
+    if (i < g_sched_len) {
+        ms = g_sched[i].val;
+        i++;
+    }
+    g_dawdle_next[pid] = i;
+    pthread_mutex_unlock(&sched_mtx);
+    return ms;
+}
+
+// ----- tracepoints -----
+// --trace FILE records fork waits, grants, posts and state changes. The
+// tracepoints stay compiled in and cost one well-predicted branch on
+// g_trace_on while off. SIGUSR1 flips them in any table run, sweeps and
+// --bench included, even without --trace (the trace then goes to
+// TRACE_DEFAULT_PATH), and with --trace-ctl CTL a helper thread polls
+// CTL for "on"/"off" every 100 ms. SIGINT and SIGTERM let the writer
+// finish the file before they take the process down.
+//
+// The first time tracing is switched on, a ring of --trace-events slots
+// and a writer thread are set up. Tracepoints reserve slots with a CAS
+// (an event is dropped rather than overwrite one not yet written), and
+// the writer drains the ring every millisecond, sorts each batch by time
+// and streams it into trace.h's seekable format, so the trace can be as
+// long as the run. State changes and fork grants and posts are traced
+// where the display applies them, under print_mtx. Each time tracing is
+// switched on, the writer snapshots the display's table under print_mtx
+// and writes it as a sync keyframe; tracepoints drop their events until
+// it has. --seek FILE shows the table at any event (--at) or time
+// (--at-ns).
+
+typedef struct {
+    atomic_long seq;        // slot number + 1 once the event is in
+    long long ts;
+    unsigned char kind;
+    unsigned char pid;
+    unsigned short arg;
+}
+trace_ev_t;
+
+#define TRACE_DEFAULT_PATH "dine.trc"
+
+static atomic_int g_trace_on;
+static atomic_uint g_trace_gen;         // bumped each time tracing turns on
+static atomic_uint g_trace_synced;      // gen the writer last snapshotted
+static const char *g_trace_path;        // --trace FILE
+static const char *g_trace_ctl;         // --trace-ctl FILE
+static long g_trace_cap = 1L << 16;     // --trace-events N: ring slots
+static long g_trace_every = 1024;       // --trace-keyframe K: events per block
+static trace_ev_t *g_trace_ring;        // allocated on first use
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static atomic_long g_trace_len;         // slots handed out
+static atomic_long g_trace_drained;     // slots the writer is done with
+static atomic_long g_trace_dropped;     // events that found the ring full
+static atomic_int g_trace_done;
+static atomic_int g_trace_fatal;        // SIGINT/SIGTERM to re-raise when done
+static atomic_int g_trace_ctl_stop;
+static atomic_int g_trace_started;      // writer thread exists
+static pthread_t trace_ctl_tid, trace_writer_tid;
+
+#define TRACE(kind, pid, arg)                                              \
+    do {                                                                   \
+        if (__builtin_expect(atomic_load_explicit(&g_trace_on,             \
+                                                  memory_order_relaxed), 0)) \
+            trace_emit((kind), (pid), (arg));                              \
+    } while (0)
+
+static void trace_on(int on) {
+    if (atomic_exchange(&g_trace_on, on) == 0 && on) {
+        atomic_fetch_add(&g_trace_gen, 1);
+    }
+}
+
+// the display's table, relative to the run start: caller holds print_mtx
+static void trace_snapshot_locked(trace_frame_t *f) {
+    memset(f, 0, sizeof *f);
+    f->n = NUM_PHILOSOPHERS;
+    f->ts = now_ns() - g_run_start;
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        f->state[i] = (unsigned char)g_state[i];
+        f->hold[i] = (unsigned char)(g_hold_left[i] | g_hold_right[i] << 1);
+    }
+}
+
+static int cmp_trace_event(const void *a, const void *b) {
+    long long x = ((const trace_event_t *)a)->ts;
+    long long y = ((const trace_event_t *)b)->ts;
+    return (x > y) - (x < y);
+}
+
+// moves the reserved slots up to `to` out of the ring into the trace
+static void trace_drain(trace_writer_t *w, trace_event_t *batch, long to) {
+    long from = atomic_load(&g_trace_drained);
+    if (to <= from) return;
+    for (long slot = from; slot < to; slot++) {
+        trace_ev_t *e = &g_trace_ring[slot % g_trace_cap];
+        // reserved but not yet filled in: a few instructions away
+        while (atomic_load_explicit(&e->seq, memory_order_acquire) != slot + 1) {
+            sched_yield();
+        }
+        long long ts = e->ts - g_run_start;
+        batch[slot - from] = (trace_event_t){ ts > 0 ? ts : 0, e->kind,
+                                              e->pid, e->arg };
+    }
+    atomic_store(&g_trace_drained, to);
+    qsort(batch, (size_t)(to - from), sizeof *batch, cmp_trace_event);
+    for (long i = 0; w != NULL && i < to - from; i++) trace_append(w, &batch[i]);
+}
+
+static void *trace_writer_thread(void *vp) {
+    (void)vp;
+    trace_event_t *batch = malloc((size_t)g_trace_cap * sizeof *batch);
+    if (batch == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    trace_writer_t *w = NULL;
+    for (;;) {
+        int done = atomic_load(&g_trace_done);
+        trace_drain(w, batch, atomic_load(&g_trace_len));
+        unsigned gen = atomic_load(&g_trace_gen);
+        if (!done && atomic_load(&g_trace_on) &&
+            gen != atomic_load(&g_trace_synced)) {
+            if (w == NULL) {
+                w = trace_create(g_trace_path, NUM_PHILOSOPHERS,
+                                 (int)g_trace_every);
+                if (w == NULL) exit(1);
+            }
+            // every event that changes the table is emitted under
+            // print_mtx, so the snapshot splits them cleanly: slots taken
+            // before it precede it, and from the unlock on nothing is
+            // dropped
+            trace_frame_t f;
+            pthread_mutex_lock(&print_mtx);
+            trace_snapshot_locked(&f);
+            long cut = atomic_load(&g_trace_len);
+            atomic_store(&g_trace_synced, gen);
+            pthread_mutex_unlock(&print_mtx);
+            trace_drain(w, batch, cut);
+            trace_sync(w, &f);
+        }
+        if (done) break;
+        sleep_ms(1);
+    }
+    if (w != NULL) trace_end(w);
+    free(batch);
+    int sig = atomic_load(&g_trace_fatal);
+    if (sig != 0) {
+        signal(sig, SIG_DFL);
+        raise(sig);
+    }
+    return NULL;
+}
+
+static void trace_launch(void) {
+    g_trace_ring = calloc((size_t)g_trace_cap, sizeof *g_trace_ring);
+    if (g_trace_ring == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    if (g_trace_path == NULL) g_trace_path = TRACE_DEFAULT_PATH;
+    int rc = pthread_create(&trace_writer_tid, NULL, trace_writer_thread, NULL);
+    if (rc != 0) die_errno("pthread_create", rc);
+    g_trace_started = 1;
+}
+
+static void trace_emit(int kind, int pid, int arg) {
+    pthread_once(&trace_once, trace_launch);
+    // until the writer has snapshotted the table, events would apply to
+    // a table it does not have
+    if (atomic_load(&g_trace_synced) != atomic_load(&g_trace_gen)) return;
+    long long ts = now_ns();
+    long slot = atomic_load(&g_trace_len);
+    do {
+        if (slot - atomic_load(&g_trace_drained) >= g_trace_cap) {
+            atomic_fetch_add_explicit(&g_trace_dropped, 1, memory_order_relaxed);
+            return;
+        }
+    } while (!atomic_compare_exchange_weak(&g_trace_len, &slot, slot + 1));
+    trace_ev_t *e = &g_trace_ring[slot % g_trace_cap];
+    e->ts = ts;
+    e->kind = (unsigned char)kind;
+    e->pid = (unsigned char)pid;
+    e->arg = (unsigned short)arg;
+    atomic_store_explicit(&e->seq, slot + 1, memory_order_release);
+}
+
+static void trace_signal(int sig) {
+    (void)sig;
+    trace_on(!atomic_load(&g_trace_on));
+}
+
+// SIGINT/SIGTERM: with a trace being written, have the writer end it and
+// re-raise; otherwise die as usual
+static void trace_fatal_signal(int sig) {
+    if (!atomic_load(&g_trace_started)) {
+        signal(sig, SIG_DFL);
+        raise(sig);
+        return;
+    }
+    atomic_store(&g_trace_fatal, sig);
+    atomic_store(&g_trace_done, 1);
+}
+
+static void *trace_ctl_thread(void *vp) {
+    (void)vp;
+    while (!atomic_load(&g_trace_ctl_stop)) {
+        FILE *fp = fopen(g_trace_ctl, "r");
+        if (fp != NULL) {
+            char word[16] = "";
+            if (fscanf(fp, "%15s", word) == 1) {
+                if (strcmp(word, "on") == 0 || strcmp(word, "1") == 0) {
+                    trace_on(1);
+                } else if (strcmp(word, "off") == 0 || strcmp(word, "0") == 0) {
+                    trace_on(0);
+                }
+            }
+            fclose(fp);
+        }
+        sleep_ms(100);
+    }
+    return NULL;
+}
+
+static void trace_handle(int sig, void (*handler)(int)) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sa_handler = handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    if (sigaction(sig, &sa, NULL) == -1) {
+        perror("sigaction");
+        exit(1);
+    }
+}
+
+// installs the SIGUSR1 toggle and the SIGINT/SIGTERM finisher; with
+// --trace, also starts tracing or the control file poller
+static void trace_start(void) {
+    trace_handle(SIGUSR1, trace_signal);
+    trace_handle(SIGINT, trace_fatal_signal);
+    trace_handle(SIGTERM, trace_fatal_signal);
+    if (g_trace_path == NULL) return;
+    if (g_trace_ctl != NULL) {
+        int rc = pthread_create(&trace_ctl_tid, NULL, trace_ctl_thread, NULL);
+        if (rc != 0) die_errno("pthread_create", rc);
+    } else {
+        // no control file: trace from the start
+        trace_on(1);
+        pthread_once(&trace_once, trace_launch);
+    }
+}
+
+// finishes the trace, if tracing was ever switched on
+static void trace_finish(void) {
+    // from here the writer is not coming back to re-raise
+    trace_handle(SIGINT, SIG_DFL);
+    trace_handle(SIGTERM, SIG_DFL);
+    atomic_store(&g_trace_on, 0);
+    if (g_trace_path != NULL && g_trace_ctl != NULL) {
+        atomic_store(&g_trace_ctl_stop, 1);
+        pthread_join(trace_ctl_tid, NULL);
+    }
+    if (!g_trace_started) return;
+    atomic_store(&g_trace_done, 1);
+    pthread_join(trace_writer_tid, NULL);
+    long dropped = atomic_load(&g_trace_dropped);
+    if (dropped > 0) {
+        fprintf(stderr, "trace: ring full, %ld events dropped "
+                "(raise --trace-events)\n", dropped);
+    }
+    if (atomic_load(&g_trace_synced) == 0) {
+        fprintf(stderr, "trace: never got going, nothing written\n");
+    } else if (strcmp(g_trace_path, TRACE_DEFAULT_PATH) == 0) {
+        fprintf(stderr, "trace: written to %s\n", g_trace_path);
+    }
+    free(g_trace_ring);
+}
+
+// ----- interleaving explorer: thread side -----
+// under --explore the real philosopher threads run one at a time: each
+// parks at every synchronization point (fork wait, fork post, state
+// publish) until the scheduler in explore_main() hands it the turn, and a
+// fork wait that would block parks as blocked until that fork is posted
+enum { XP_OFF = 0, XP_RANDOM, XP_DFS };
+enum { XP_WAIT = 1, XP_BLOCKED, XP_POST, XP_PUBLISH, XP_HOLD };
+#define XP_SEAT NUM_PHILOSOPHERS   // resource index of the waiter's seats
+
+typedef struct {
+    int parked;      // stopped at a sync point, waiting for the turn
+    int done;        // philosopher() returned
+    int point;       // XP_* it is parked at
+    int arg;         // fork index or published value
+    int blocked_on;  // fork (or XP_SEAT) a failed try waits for, or -1
+    int hungry;      // between its first fork wait and eating
+    int overtaken;   // neighbor meals started while hungry
+}
+xp_thread_t;
+
+static int g_explore;                  // XP_OFF, XP_RANDOM or XP_DFS
+static pthread_mutex_t xp_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t xp_cv = PTHREAD_COND_INITIALIZER; // scheduler waits
+static pthread_cond_t xp_go[NUM_PHILOSOPHERS];            // per-thread turn
+static xp_thread_t xp_th[NUM_PHILOSOPHERS];
+static int xp_running;                 // threads between sync points
+static int xp_turn = -1;               // thread allowed to proceed
+static int xp_owner[NUM_PHILOSOPHERS]; // who the explorer saw take each fork
+static int xp_max_overtaken;
+static char xp_violation[160];         // first violation of this run
+
+static int xp_try(int pid, int res);
+
+static void xp_park(int pid, int point, int arg) {
+    pthread_mutex_lock(&xp_mtx);
+    xp_th[pid].parked = 1;
+    xp_th[pid].point = point;
+    xp_th[pid].arg = arg;
+    if (--xp_running == 0) pthread_cond_signal(&xp_cv);
+    while (xp_turn != pid) {
+        pthread_cond_wait(&xp_go[pid], &xp_mtx);
+    }
+    xp_turn = -1;
+    xp_th[pid].parked = 0;
+    pthread_mutex_unlock(&xp_mtx);
+}
+
+static void xp_exit(int pid) {
+    pthread_mutex_lock(&xp_mtx);
+    xp_th[pid].done = 1;
+    if (--xp_running == 0) pthread_cond_signal(&xp_cv);
+    pthread_mutex_unlock(&xp_mtx);
+}
+
+static void xp_fail(const char *msg) {
+    if (xp_violation[0] == '\0') {
+        snprintf(xp_violation, sizeof xp_violation, "%s", msg);
+    }
+}
+
+// explorer's fork (or seat) wait: try, and park as blocked until a post
+// on failure. Only the thread holding the turn runs, so none of this races.
+static void xp_acquire(int pid, int idx) {
+    int held = 0;
+    for (int f = 0; f < NUM_PHILOSOPHERS; f++) {
+        if (xp_owner[f] == pid) held++;
+    }
+    if (held == 0) xp_th[pid].hungry = 1;
+
+    xp_park(pid, XP_WAIT, idx);
+    while (!xp_try(pid, idx)) {
+        xp_th[pid].blocked_on = idx;
+        xp_park(pid, XP_BLOCKED, idx);
+    }
+    if (idx == XP_SEAT) return;
+    if (xp_owner[idx] >= 0) {
+        char msg[96];
+        snprintf(msg, sizeof msg, "fork %d granted to %c while held by %c",
+                 idx, 'A' + pid, 'A' + xp_owner[idx]);
+        xp_fail(msg);
+    }
+    xp_owner[idx] = pid;
+}
+
+// explorer's view of a fork post: wakes whoever was blocked on it
+static void xp_release(int pid, int idx) {
+    xp_park(pid, XP_POST, idx);
+    if (idx != XP_SEAT) xp_owner[idx] = -1;
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        if (xp_th[i].blocked_on == idx) xp_th[i].blocked_on = -1;
+    }
+}
+
+// bounded waiting: count meals a hungry philosopher's neighbors start
+static void xp_published(int pid, state_t st) {
+    if (st != ST_EATING) return;
+    xp_th[pid].hungry = 0;
+    xp_th[pid].overtaken = 0;
+    int nb[2] = { (pid + 1) % NUM_PHILOSOPHERS,
+                  (pid + NUM_PHILOSOPHERS - 1) % NUM_PHILOSOPHERS };
+    for (int k = 0; k < 2; k++) {
+        xp_thread_t *t = &xp_th[nb[k]];
+        if (nb[k] != pid && t->hungry) {
+            t->overtaken++;
+            if (t->overtaken > xp_max_overtaken) {
+                xp_max_overtaken = t->overtaken;
+            }
+        }
+    }
+}
+
+// ----- adaptive strategy -----
+// --adaptive switches between parity (light contention) and the waiter
+// (heavy contention) while the table runs. Each philosopher keeps moving
+// averages of how often a fork it reached for was taken and of its
+// hungry time. When the table-wide busy share crosses --adapt-high or the
+// average hungry time crosses --adapt-wait, the next epoch gets the
+// waiter; when the busy share falls under --adapt-low and hungry time
+// under half of --adapt-wait, it goes back to parity.
+// Philosophers register in the epoch they start acquiring under, and
+// entrants of a new epoch wait for the old one to drain, so forks are
+// never held under two strategies at once.
+typedef struct {
+    int tries, busy;         // fork reaches this meal / found already taken
+    int meals;
+    atomic_int busy_pm;      // moving average of busy reaches, per mille
+    atomic_long wait_us;     // moving average of hungry time
+}
+adapt_phil_t;
+
+static int g_adaptive;
+static long g_adapt_high = 50;   // --adapt-high: % busy to go to the waiter
+static long g_adapt_low = 20;    // --adapt-low: % busy to go back to parity
+static long g_adapt_wait_ms;     // --adapt-wait: hungry ms for the waiter,
+                                 // 0 = --dawdle (at least 1)
+static atomic_uint g_epoch;
+static atomic_int g_epoch_strategy[2];
+static atomic_int g_inflight[2];  // philosophers between acquire and release
+static atomic_int g_adapt_mode;   // 0 parity, 1 waiter
+static pthread_mutex_t adapt_mtx = PTHREAD_MUTEX_INITIALIZER;
+static long g_switches;
+static long long g_mode_ns[2], g_mode_since;
+static adapt_phil_t g_adapt[NUM_PHILOSOPHERS];
+
+static void adapt_reset(void) {
+    atomic_store(&g_epoch, 0);
+    atomic_store(&g_epoch_strategy[0], STRAT_PARITY);
+    atomic_store(&g_inflight[0], 0);
+    atomic_store(&g_inflight[1], 0);
+    atomic_store(&g_adapt_mode, 0);
+    g_switches = 0;
+    g_mode_ns[0] = g_mode_ns[1] = 0;
+    g_mode_since = now_ns();
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        g_adapt[i].tries = g_adapt[i].busy = g_adapt[i].meals = 0;
+        atomic_store(&g_adapt[i].busy_pm, 0);
+        atomic_store(&g_adapt[i].wait_us, 0);
+    }
+}
+
+static void adapt_note_fork(int pid, int busy) {
+    g_adapt[pid].tries++;
+    g_adapt[pid].busy += busy;
+}
+
+// joins the current epoch once the previous one has drained; returns it
+static unsigned adapt_enter(void) {
+    const struct timespec nap = { 0, 100000 };
+    for (;;) {
+        unsigned e = atomic_load(&g_epoch);
+        if (atomic_load(&g_inflight[(e + 1) & 1]) != 0) {
+            nanosleep(&nap, NULL);
+            continue;
+        }
+        atomic_fetch_add(&g_inflight[e & 1], 1);
+        if (atomic_load(&g_epoch) == e) return e;
+        atomic_fetch_sub(&g_inflight[e & 1], 1);
+    }
+}
+
+static void adapt_exit(unsigned e) {
+    atomic_fetch_sub(&g_inflight[e & 1], 1);
+}
+
+static void adapt_switch(int high) {
+    pthread_mutex_lock(&adapt_mtx);
+    unsigned e = atomic_load(&g_epoch);
+    // the slot the next epoch reuses must be empty: one switch at a time
+    if (atomic_load(&g_adapt_mode) != high &&
+        atomic_load(&g_inflight[(e + 1) & 1]) == 0) {
+        atomic_store(&g_epoch_strategy[(e + 1) & 1],
+                     high ? STRAT_WAITER : STRAT_PARITY);
+        atomic_store(&g_epoch, e + 1);
+        long long now = now_ns();
+        g_mode_ns[!high] += now - g_mode_since;
+        g_mode_since = now;
+        atomic_store(&g_adapt_mode, high);
+        g_switches++;
+    }
+    pthread_mutex_unlock(&adapt_mtx);
+}
+
+// folds one meal's samples into the averages; every 8th meal also checks
+// the table-wide busy share against the thresholds
+static void adapt_after_meal(int pid, long long hungry_ns) {
+    adapt_phil_t *a = &g_adapt[pid];
+    int pm = a->tries ? 1000 * a->busy / a->tries : 0;
+    a->tries = a->busy = 0;
+    int avg = atomic_load_explicit(&a->busy_pm, memory_order_relaxed);
+    atomic_store_explicit(&a->busy_pm, avg + (pm - avg) / 8, memory_order_relaxed);
+    long w = atomic_load_explicit(&a->wait_us, memory_order_relaxed);
+    atomic_store_explicit(&a->wait_us, w + ((long)(hungry_ns / 1000) - w) / 8,
+                          memory_order_relaxed);
+    if (++a->meals % 8 != 0) return;
+
+    long sum = 0, wait = 0;
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        sum += atomic_load_explicit(&g_adapt[i].busy_pm, memory_order_relaxed);
+        wait += atomic_load_explicit(&g_adapt[i].wait_us, memory_order_relaxed);
+    }
+    long table_pm = sum / NUM_PHILOSOPHERS;
+    long table_us = wait / NUM_PHILOSOPHERS;
+    long wait_us = 1000 * (g_adapt_wait_ms ? g_adapt_wait_ms
+                           : g_dawdle_ms > 0 ? g_dawdle_ms : 1);
+    int mode = atomic_load_explicit(&g_adapt_mode, memory_order_relaxed);
+    if (!mode && (table_pm > g_adapt_high * 10 || table_us > wait_us)) {
+        adapt_switch(1);
+    } else if (mode && table_pm < g_adapt_low * 10 && table_us < wait_us / 2) {
+        adapt_switch(0);
+    }
+}
+
+static void print_adaptive_report(void) {
+    int mode = atomic_load(&g_adapt_mode);
+    long long ns[2] = { g_mode_ns[0], g_mode_ns[1] };
+    ns[mode] += g_run_end - g_mode_since;
+    double total = (double)(ns[0] + ns[1]);
+    long busy = 0, wait = 0;
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        busy += atomic_load(&g_adapt[i].busy_pm);
+        wait += atomic_load(&g_adapt[i].wait_us);
+    }
+    printf("adaptive: %ld switches, parity %.1f%% / waiter %.1f%% of the run, "
+           "ending with %s, busy forks %.1f%%, hungry %.2f ms (recent)\n",
+           g_switches, total > 0 ? 100.0 * (double)ns[0] / total : 0.0,
+           total > 0 ? 100.0 * (double)ns[1] / total : 0.0,
+           mode ? "waiter" : "parity",
+           (double)busy / NUM_PHILOSOPHERS / 10.0,
+           (double)wait / NUM_PHILOSOPHERS / 1000.0);
+}
+
+// ----- starvation guard -----
+// --max-hungry MS: a hungry philosopher's priority is how long it has
+// been hungry. Past half the bound it counts as starving: a neighbor
+// finishing a meal stops batching, and a neighbor about to get hungry
+// again first waits (holding nothing) until the starving one has eaten.
+// The handoff backend grants forks, and the waiter its seats, to the
+// highest-priority philosopher waiting; the other backends can't pick
+// who gets a fork, so --max-hungry requires handoff.
+static long g_max_hungry_ms;
+static atomic_llong g_hungry_since[NUM_PHILOSOPHERS];  // 0 when not hungry
+static atomic_long g_yields;           // times a philosopher stood back
+static atomic_long g_over_bound;       // meals that came after the bound
+static atomic_llong g_hungry_max_ns;
+
+static void starve_reset(void) {
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        atomic_store(&g_hungry_since[i], 0);
+    }
+    atomic_store(&g_yields, 0);
+    atomic_store(&g_over_bound, 0);
+    atomic_store(&g_hungry_max_ns, 0);
+}
+
+// priority of pid: nanoseconds hungry times its profile's weight
+static long long starve_priority(int pid, long long now) {
+    long long since = atomic_load_explicit(&g_hungry_since[pid],
+                                           memory_order_relaxed);
+    return since ? (now - since) * g_profile[pid].priority : 0;
+}
+
+static void starve_hungry(int pid) {
+    atomic_store(&g_hungry_since[pid], now_ns());
+}
+
+static void starve_fed(int pid) {
+    long long hungry = now_ns() - atomic_load(&g_hungry_since[pid]);
+    atomic_store(&g_hungry_since[pid], 0);
+    if (hungry > g_max_hungry_ms * 1000000LL) atomic_fetch_add(&g_over_bound, 1);
+    long long max = atomic_load(&g_hungry_max_ns);
+    while (hungry > max &&
+           !atomic_compare_exchange_weak(&g_hungry_max_ns, &max, hungry)) {}
+}
+
+// a neighbor of pid has been hungry past half the bound
+static int starve_neighbor(int pid) {
+    const long long aged = g_max_hungry_ms * 500000LL;
+    const int left = (pid + NUM_PHILOSOPHERS - 1) % NUM_PHILOSOPHERS;
+    long long now = now_ns();
+    return starve_priority(left, now) >= aged ||
+           starve_priority((pid + 1) % NUM_PHILOSOPHERS, now) >= aged;
+}
+
+// before getting hungry: stand back for each starving neighbor until it
+// has eaten. pid holds nothing here, and a hungry philosopher never
+// stands back, so the waits can't form a cycle
+static void starve_defer(int pid) {
+    const long long aged = g_max_hungry_ms * 500000LL;
+    const struct timespec nap = { 0, 100000 };
+    const int nbs[2] = { (pid + NUM_PHILOSOPHERS - 1) % NUM_PHILOSOPHERS,
+                         (pid + 1) % NUM_PHILOSOPHERS };
+    for (int k = 0; k < 2; k++) {
+        long long since = atomic_load(&g_hungry_since[nbs[k]]);
+        if (since == 0 || starve_priority(nbs[k], now_ns()) < aged) continue;
+        atomic_fetch_add(&g_yields, 1);
+        while (atomic_load(&g_hungry_since[nbs[k]]) == since &&
+               !atomic_load_explicit(&g_stop, memory_order_relaxed)) {
+            nanosleep(&nap, NULL);
+        }
+    }
+}
+
+static void print_starvation_report(void) {
+    printf("starvation guard: bound %ld ms, max hungry %.3f ms, %ld meals "
+           "over the bound, %ld yields\n", g_max_hungry_ms,
+           (double)atomic_load(&g_hungry_max_ns) / 1e6,
+           atomic_load(&g_over_bound), atomic_load(&g_yields));
+}
+
+// ----- forks -----
+static sem_t forks_unnamed[NUM_PHILOSOPHERS];
+
+static sem_t seats;   // waiter strategy: at most N-1 may reach for forks
+
+// with --max-hungry, a freed seat goes straight to the waiting
+// philosopher with the highest starve_priority instead
+static pthread_mutex_t seat_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t seat_cv = PTHREAD_COND_INITIALIZER;
+static int seat_free;                       // under seat_mtx
+static int seat_waiting[NUM_PHILOSOPHERS];  // under seat_mtx
+static int seat_granted[NUM_PHILOSOPHERS];  // under seat_mtx
+
+// philosophers blocked in fork_wait_idx on each fork
+static atomic_int g_fork_waiting[NUM_PHILOSOPHERS];
+
+// FORK_HANDOFF: a released fork goes straight to the oldest waiter,
+// which is woken alone; the fork is never free while someone queues
+typedef struct {
+    pthread_mutex_t mtx;
+    int held;
+    int queue[NUM_PHILOSOPHERS];    // waiting philosophers, FIFO
+    int head, len;
+}
+handoff_fork_t;
+
+static handoff_fork_t handoff_forks[NUM_PHILOSOPHERS];
+static pthread_cond_t handoff_cv[NUM_PHILOSOPHERS];  // one per philosopher
+static int handoff_granted[NUM_PHILOSOPHERS];  // under the awaited fork's mtx
+
+// FORK_TICKET: a ticket lock, so a fork is granted strictly in the order
+// it was asked for. Waiters sleep on the futex slot for their ticket and
+// a release wakes only that slot; without futexes they yield.
+#define TICKET_SLOTS 4
+
+typedef struct {
+    atomic_uint next;       // next ticket to hand out
+    atomic_uint serving;    // ticket that owns the fork
+    atomic_uint slot[TICKET_SLOTS];  // bumped when slot's ticket is served
+}
+ticket_fork_t;
+
+static ticket_fork_t ticket_forks[NUM_PHILOSOPHERS];
+
+static void ticket_sleep(atomic_uint *word, unsigned seen) {
+#ifdef __linux__
+    syscall(SYS_futex, (unsigned *)word, FUTEX_WAIT_PRIVATE, seen, NULL, NULL, 0);
+#else
+    (void)word;
+    (void)seen;
+    sched_yield();
+#endif
+}
+
+static void ticket_wake(atomic_uint *word) {
+#ifdef __linux__
+    // tickets t and t + TICKET_SLOTS share a slot, so wake them all
+    syscall(SYS_futex, (unsigned *)word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+    (void)word;
+#endif
+}
+
+static int ticket_try(int idx) {
+    ticket_fork_t *f = &ticket_forks[idx];
+    unsigned s = atomic_load(&f->serving);
+    return atomic_compare_exchange_strong(&f->next, &s, s + 1);
+}
+
+static void ticket_wait(int idx) {
+    ticket_fork_t *f = &ticket_forks[idx];
+    unsigned t = atomic_fetch_add(&f->next, 1);
+    atomic_uint *slot = &f->slot[t % TICKET_SLOTS];
+    for (;;) {
+        // read the slot before serving: a release in between bumps it and
+        // the futex wait returns at once
+        unsigned seen = atomic_load(slot);
+        if (atomic_load(&f->serving) == t) return;
+        ticket_sleep(slot, seen);
+    }
+}
+
+static void ticket_post(int idx) {
+    ticket_fork_t *f = &ticket_forks[idx];
+    unsigned t = atomic_load_explicit(&f->serving, memory_order_relaxed) + 1;
+    atomic_store(&f->serving, t);
+    atomic_uint *slot = &f->slot[t % TICKET_SLOTS];
+    atomic_fetch_add(slot, 1);
+    // nobody holds ticket t yet: the fork is free and nobody sleeps
+    if (atomic_load(&f->next) != t) ticket_wake(slot);
+}
+
+// FORK_BIASED: a fork that keeps being taken by the same philosopher
+// gets biased to them, and they then take and drop it with plain
+// stores. Anyone else must revoke the bias under the fork's mutex: raise
+// revoke, run a process-wide barrier (membarrier) so the holder's busy
+// store is visible, and wait for busy to drop. The barrier is what lets
+// the fast path skip its own fence; without membarrier both sides fence.
+typedef struct {
+    atomic_int bias;        // philosopher the fork is biased to, or -1
+    atomic_int busy;        // bias holder has the fork (fast path)
+    atomic_int revoke;      // a revocation is in progress
+    pthread_mutex_t mtx;    // held for an unbiased acquisition
+    int fast;               // holder took the fork on the fast path
+    int streak_pid, streak; // consecutive slow grants to one philosopher
+}
+biased_fork_t;
+
+#define BIAS_STREAK 2       // slow grants in a row before biasing
+
+static biased_fork_t biased_forks[NUM_PHILOSOPHERS];
+static int g_membarrier;    // expedited membarrier is registered
+static atomic_long g_bias_hits, g_bias_slow, g_bias_revokes;
+static atomic_llong g_bias_fence_ns, g_bias_revoke_ns;
+
+static void biased_init(void) {
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        biased_fork_t *f = &biased_forks[i];
+        atomic_store(&f->bias, -1);
+        atomic_store(&f->busy, 0);
+        atomic_store(&f->revoke, 0);
+        die_errno("pthread_mutex_init", pthread_mutex_init(&f->mtx, NULL));
+        f->fast = 0;
+        f->streak_pid = -1;
+        f->streak = 0;
+    }
+    atomic_store(&g_bias_hits, 0);
+    atomic_store(&g_bias_slow, 0);
+    atomic_store(&g_bias_revokes, 0);
+    atomic_store(&g_bias_fence_ns, 0);
+    atomic_store(&g_bias_revoke_ns, 0);
+#ifdef __linux__
+    g_membarrier = syscall(SYS_membarrier,
+                           MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+#endif
+}
+
+// the revoker's half of the fence pair
+static void bias_heavy_fence(void) {
+#ifdef __linux__
+    if (g_membarrier &&
+        syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0) == 0) {
+        return;
+    }
+#endif
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+// the holder's half: a compiler barrier when the revoker does the work
+static inline void bias_light_fence(void) {
+    if (g_membarrier) {
+        atomic_signal_fence(memory_order_seq_cst);
+    } else {
+        atomic_thread_fence(memory_order_seq_cst);
+    }
+}
+
+static int biased_fast(int pid, biased_fork_t *f) {
+    if (atomic_load_explicit(&f->bias, memory_order_relaxed) != pid) return 0;
+    atomic_store_explicit(&f->busy, 1, memory_order_relaxed);
+    bias_light_fence();
+    if (!atomic_load_explicit(&f->revoke, memory_order_acquire) &&
+        atomic_load_explicit(&f->bias, memory_order_relaxed) == pid) {
+        f->fast = 1;
+        atomic_fetch_add_explicit(&g_bias_hits, 1, memory_order_relaxed);
+        return 1;
+    }
+    atomic_store_explicit(&f->busy, 0, memory_order_release);
+    return 0;
+}
+
+// with f->mtx held: take the bias away from its holder. If wait is 0
+// and the holder has the fork, gives up and returns 0
+static int biased_revoke(int pid, biased_fork_t *f, int wait) {
+    int b = atomic_load(&f->bias);
+    if (b == -1 || b == pid) {
+        atomic_store(&f->bias, -1);
+        return 1;
+    }
+    long long t0 = now_ns();
+    atomic_store(&f->revoke, 1);
+    bias_heavy_fence();
+    long long t1 = now_ns();
+    const struct timespec nap = { 0, 50000 };
+    while (atomic_load(&f->busy)) {
+        if (!wait) {
+            atomic_store(&f->revoke, 0);
+            return 0;
+        }
+        nanosleep(&nap, NULL);
+    }
+    atomic_store(&f->bias, -1);
+    atomic_store_explicit(&f->revoke, 0, memory_order_release);
+    atomic_fetch_add(&g_bias_revokes, 1);
+    atomic_fetch_add(&g_bias_fence_ns, t1 - t0);
+    atomic_fetch_add(&g_bias_revoke_ns, now_ns() - t0);
+    return 1;
+}
+
+static void biased_granted_slow(biased_fork_t *f) {
+    f->fast = 0;
+    atomic_fetch_add_explicit(&g_bias_slow, 1, memory_order_relaxed);
+}
+
+static int biased_try(int pid, int idx) {
+    biased_fork_t *f = &biased_forks[idx];
+    if (biased_fast(pid, f)) return 1;
+    if (pthread_mutex_trylock(&f->mtx) != 0) return 0;
+    if (!biased_revoke(pid, f, 0)) {
+        pthread_mutex_unlock(&f->mtx);
+        return 0;
+    }
+    biased_granted_slow(f);
+    return 1;
+}
+
+static void biased_wait(int pid, int idx) {
+    biased_fork_t *f = &biased_forks[idx];
+    if (biased_fast(pid, f)) return;
+    pthread_mutex_lock(&f->mtx);
+    biased_revoke(pid, f, 1);
+    biased_granted_slow(f);
+}
+
+static void biased_post(int pid, int idx) {
+    biased_fork_t *f = &biased_forks[idx];
+    if (f->fast) {
+        atomic_store_explicit(&f->busy, 0, memory_order_release);
+        return;
+    }
+    // a run of uncontended grants to pid: bias the fork to them
+    if (f->streak_pid == pid) {
+        f->streak++;
+    } else {
+        f->streak_pid = pid;
+        f->streak = 1;
+    }
+    if (f->streak >= BIAS_STREAK && atomic_load(&g_fork_waiting[idx]) == 0) {
+        atomic_store(&f->bias, pid);
+        f->streak = 0;
+    }
+    pthread_mutex_unlock(&f->mtx);
+}
+
+static void print_bias_report(void) {
+    long hits = atomic_load(&g_bias_hits), slow = atomic_load(&g_bias_slow);
+    long rev = atomic_load(&g_bias_revokes);
+    if (hits + slow == 0) return;
+    printf("bias: %.1f%% fast-path hits of %ld acquisitions, %ld revocations",
+           100.0 * (double)hits / (double)(hits + slow), hits + slow, rev);
+    if (rev > 0) {
+        printf(", %s %.1f us, total %.3f ms each",
+               g_membarrier ? "membarrier" : "fence",
+               (double)atomic_load(&g_bias_fence_ns) / (double)rev / 1e3,
+               (double)atomic_load(&g_bias_revoke_ns) / (double)rev / 1e6);
+    }
+    printf("\n");
+}
+
+static void forks_init_all(void) {
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        if (sem_init(&forks_unnamed[i], 0, 1) == -1) {
+            perror("sem_init");
+            exit(1);
+        }
+        die_errno("pthread_mutex_init",
+                  pthread_mutex_init(&handoff_forks[i].mtx, NULL));
+        die_errno("pthread_cond_init", pthread_cond_init(&handoff_cv[i], NULL));
+        handoff_forks[i].held = 0;
+        handoff_forks[i].head = handoff_forks[i].len = 0;
+        atomic_store(&ticket_forks[i].next, 0);
+        atomic_store(&ticket_forks[i].serving, 0);
+    }
+    if (g_tune.backend == FORK_BIASED) biased_init();
+    if (sem_init(&seats, 0, NUM_PHILOSOPHERS - 1) == -1) {
+        perror("sem_init");
+        exit(1);
+    }
+    seat_free = NUM_PHILOSOPHERS - 1;
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        seat_waiting[i] = seat_granted[i] = 0;
+    }
+}
+
+static void forks_destroy_all(void) {
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        if (sem_destroy(&forks_unnamed[i]) == -1) {
+            perror("sem_destroy");
+        }
+        pthread_mutex_destroy(&handoff_forks[i].mtx);
+        pthread_cond_destroy(&handoff_cv[i]);
+        if (g_tune.backend == FORK_BIASED) {
+            pthread_mutex_destroy(&biased_forks[i].mtx);
+        }
+    }
+    if (sem_destroy(&seats) == -1) {
+        perror("sem_destroy");
+    }
+}
+
+static int handoff_try(int idx) {
+    handoff_fork_t *f = &handoff_forks[idx];
+    pthread_mutex_lock(&f->mtx);
+    int got = !f->held;
+    if (got) f->held = 1;
+    pthread_mutex_unlock(&f->mtx);
+    return got;
+}
+
+static void handoff_wait(int pid, int idx) {
+    handoff_fork_t *f = &handoff_forks[idx];
+    pthread_mutex_lock(&f->mtx);
+    if (!f->held) {
+        f->held = 1;
+    } else {
+        f->queue[(f->head + f->len++) % NUM_PHILOSOPHERS] = pid;
+        handoff_granted[pid] = 0;
+        while (!handoff_granted[pid]) {
+            pthread_cond_wait(&handoff_cv[pid], &f->mtx);
+        }
+    }
+    pthread_mutex_unlock(&f->mtx);
+}
+
+static void handoff_post(int idx) {
+    handoff_fork_t *f = &handoff_forks[idx];
+    pthread_mutex_lock(&f->mtx);
+    if (f->len > 0) {
+        if (g_max_hungry_ms) {
+            // oldest hungry waiter first: swap it to the head
+            long long now = now_ns();
+            for (int k = 1; k < f->len; k++) {
+                int *a = &f->queue[f->head];
+                int *b = &f->queue[(f->head + k) % NUM_PHILOSOPHERS];
+                if (starve_priority(*b, now) > starve_priority(*a, now)) {
+                    int t = *a;
+                    *a = *b;
+                    *b = t;
+                }
+            }
+        }
+        int next = f->queue[f->head];
+        f->head = (f->head + 1) % NUM_PHILOSOPHERS;
+        f->len--;
+        handoff_granted[next] = 1;    // still held: now by next
+        pthread_cond_signal(&handoff_cv[next]);
+    } else {
+        f->held = 0;
+    }
+    pthread_mutex_unlock(&f->mtx);
+}
+
+// non-blocking acquire, for the interleaving explorer
+static int fork_try_idx(int pid, int idx) {
+    if (g_tune.backend == FORK_HANDOFF) return handoff_try(idx);
+    if (g_tune.backend == FORK_TICKET) return ticket_try(idx);
+    if (g_tune.backend == FORK_BIASED) return biased_try(pid, idx);
+    return sem_trywait(&forks_unnamed[idx]) == 0;
+}
+
+static int xp_try(int pid, int res) {
+    return res == XP_SEAT ? sem_trywait(&seats) == 0 : fork_try_idx(pid, res);
+}
+
+// FORK_SPIN: retry with a doubling pause before falling back to sem_wait
+static int fork_spin_idx(int idx) {
+    int pause = 1;
+    for (int k = 0; k < g_tune.spin_limit; k++) {
+        if (sem_trywait(&forks_unnamed[idx]) == 0) return 1;
+        for (int j = 0; j < pause; j++) cpu_relax();
+        if (pause < g_tune.backoff_max) pause *= 2;
+    }
+    return 0;
+}
+
+// someone is waiting for one of the forks pid holds
+static int forks_wanted(int pid) {
+    return atomic_load_explicit(&g_fork_waiting[args[pid].left_fork],
+                                memory_order_relaxed) +
+           atomic_load_explicit(&g_fork_waiting[args[pid].right_fork],
+                                memory_order_relaxed) > 0;
+}
+
+static void fork_wait_idx(int pid, int idx) {
+    long long t0 = g_stats ? now_ns() : 0;
+    TRACE(TRACE_WAIT, pid, idx);
+    atomic_fetch_add_explicit(&g_fork_waiting[idx], 1, memory_order_relaxed);
+    if (g_explore) {
+        xp_acquire(pid, idx);
+    } else {
+        if (g_replay_path != NULL) replay_gate(pid, idx);
+        int got = 0;
+        if (g_adaptive) {
+            got = fork_try_idx(pid, idx);
+            adapt_note_fork(pid, !got);
+        }
+        if (!got && g_tune.backend == FORK_HANDOFF) {
+            handoff_wait(pid, idx);
+        } else if (!got && g_tune.backend == FORK_TICKET) {
+            ticket_wait(idx);
+        } else if (!got && g_tune.backend == FORK_BIASED) {
+            biased_wait(pid, idx);
+        } else if (!got && (g_tune.backend != FORK_SPIN || !fork_spin_idx(idx))) {
+            while (sem_wait(&forks_unnamed[idx]) == -1 && errno == EINTR) {}
+        }
+        if (g_replay_path != NULL) replay_advance();
+    }
+    atomic_fetch_sub_explicit(&g_fork_waiting[idx], 1, memory_order_relaxed);
+    if (g_record_path != NULL) sched_append('G', pid, idx);
+
+    // the fork is ours now, so its record needs no further locking
+    if (g_stats) {
+        fork_stat_t *fs = &g_fork_stats[idx];
+        long long t1 = now_ns();
+        fs->acquisitions++;
+        fs->wait_ns += t1 - t0;
+        fs->held_since = t1;
+    }
+}
+
+static void fork_post_idx(int pid, int idx) {
+    if (g_explore) xp_release(pid, idx);
+    if (g_stats) {
+        fork_stat_t *fs = &g_fork_stats[idx];
+        fs->held_ns += now_ns() - fs->held_since;
+    }
+    if (g_tune.backend == FORK_HANDOFF) {
+        handoff_post(idx);
+    } else if (g_tune.backend == FORK_TICKET) {
+        ticket_post(idx);
+    } else if (g_tune.backend == FORK_BIASED) {
+        biased_post(pid, idx);
+    } else if (sem_post(&forks_unnamed[idx]) == -1) {
+        perror("sem_post");
+        exit(1);
+    }
+}
+
+// waiter strategy: take / give back one of the N-1 seats
+static void seat_wait(int pid) {
+    if (g_explore) {
+        xp_acquire(pid, XP_SEAT);
+        return;
+    }
+    if (g_max_hungry_ms) {
+        pthread_mutex_lock(&seat_mtx);
+        if (seat_free > 0) {
+            seat_free--;
+        } else {
+            seat_waiting[pid] = 1;
+            while (!seat_granted[pid]) pthread_cond_wait(&seat_cv, &seat_mtx);
+            seat_granted[pid] = 0;
+        }
+        pthread_mutex_unlock(&seat_mtx);
+        return;
+    }
+    while (sem_wait(&seats) == -1 && errno == EINTR) {}
+}
+
+static void seat_post(int pid) {
+    if (g_explore) xp_release(pid, XP_SEAT);
+    if (g_max_hungry_ms) {
+        pthread_mutex_lock(&seat_mtx);
+        long long now = now_ns(), best_prio = -1;
+        int best = -1;
+        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+            if (!seat_waiting[i]) continue;
+            long long prio = starve_priority(i, now);
+            if (prio > best_prio) best = i, best_prio = prio;
+        }
+        if (best >= 0) {
+            seat_waiting[best] = 0;
+            seat_granted[best] = 1;
+            pthread_cond_broadcast(&seat_cv);
+        } else {
+            seat_free++;
+        }
+        pthread_mutex_unlock(&seat_mtx);
+        return;
+    }
+    if (sem_post(&seats) == -1) {
+        perror("sem_post");
+        exit(1);
+    }
+}
+
+// causes the philosopher to pause for a random
+// amount of time between 0 and DAWDLEFACTOR (or --dawdle) milliseconds
+static void dawdle(int pid, const dist_t *d) {
+    // sleep for 0..DAWDLEFACTOR ms, or as the philosopher's profile says
+    long ms = -1;
+    if (g_explore) return;  // the explorer only cares about ordering
+    if (g_replay_path != NULL) ms = replay_duration(pid);
+    if (ms < 0) ms = dist_draw(d);
+    if (g_record_path != NULL) sched_append('D', pid, ms);
+    sleep_ms(ms);
+}
+
+// --preempt MS: a meal is eaten in slices of MS, and after each slice it
+// ends early if a neighbor is waiting for one of the forks
+static long g_preempt_ms;
+static atomic_long g_preempted;       // meals cut short
+static atomic_llong g_preempt_saved_ms;
+
+static void eat(int pid) {
+    if (g_preempt_ms == 0) {
+        dawdle(pid, &g_profile[pid].eat);
+        return;
+    }
+    long left = dist_draw(&g_profile[pid].eat);
+    while (left > 0) {
+        long slice = left < g_preempt_ms ? left : g_preempt_ms;
+        sleep_ms(slice);
+        left -= slice;
+        if (left > 0 && forks_wanted(pid)) {
+            atomic_fetch_add(&g_preempted, 1);
+            atomic_fetch_add(&g_preempt_saved_ms, left);
+            return;
+        }
+    }
+}
+
+static void print_preempt_report(long meals) {
+    long cut = atomic_load(&g_preempted);
+    printf("preempt: %ld of %ld meals cut short (%.1f%%), %.3f s of eating "
+           "given back\n", cut, meals,
+           meals > 0 ? 100.0 * (double)cut / (double)meals : 0.0,
+           (double)atomic_load(&g_preempt_saved_ms) / 1e3);
+}
+
+static char label_for(int i) {
+    // start at 'A' and continue up the ASCII table
+    return (char)('A' + i);
+}
+
+// build a forks string per column of length NUM_PHILOSOPHERS,
+// marking only the forks held by this philosopher with their index digit
+// and '-' elsewhere
+static void build_fork_str(int pid, int left_held, int right_held,
+                           char *buf, size_t buflen) {
+    // display dashes '-'
+    for (int i = 0; i < NUM_PHILOSOPHERS && (size_t)i < buflen - 1; i++) {
+        buf[i] = '-';
+    }
+    // null terminate
+    if (NUM_PHILOSOPHERS < (int)buflen - 1) {
+        buf[NUM_PHILOSOPHERS] = '\0';
+    }
+    else {
+        buf[buflen - 1] = '\0';
+    }
+
+    int lf = args[pid].left_fork;
+    int rf = args[pid].right_fork;
+
+    if (left_held) {
+        buf[lf] = (char)('0' + (lf % 10));
+    }
+    if (right_held) {
+        buf[rf] = (char)('0' + (rf % 10));
+    }
+}
+
+static const char* state_suffix(state_t s) {
+    switch (s) {
+        case ST_EATING:   return " Eat";
+        case ST_THINKING: return " Think";
+        default:          return " ";
+    }
+}
+
+// longest row format_status_row produces, newline included
+#define ROW_MAX (4 + NUM_PHILOSOPHERS * (NUM_PHILOSOPHERS + 14))
+
+// renders a table as one row into buf; returns its length
+static size_t format_row(char *buf, size_t len, const state_t *state,
+                         const int *left_held, const int *right_held) {
+    char fbuf[NUM_PHILOSOPHERS + 1];
+    size_t n = (size_t)snprintf(buf, len, "| ");
+    for (int i = 0; i < NUM_PHILOSOPHERS && n < len; i++) {
+        build_fork_str(i, left_held[i], right_held[i], fbuf, sizeof fbuf);
+        const char *suf = state_suffix(state[i]);
+        // show fork string + " Eat"/" Think", blank for changing
+        // align columns for neatness
+        n += (size_t)snprintf(buf + n, len - n, "%-5s%-7s| ", fbuf, suf);
+    }
+    if (n < len) n += (size_t)snprintf(buf + n, len - n, "\n");
+    return n < len ? n : len - 1;
+}
+
+// renders the live table
+static size_t format_status_row(char *buf, size_t len) {
+    return format_row(buf, len, g_state, g_hold_left, g_hold_right);
+}
+
+// internal printer: caller must hold print_mtx
+static void print_status_locked(void) {
+    if (g_quiet) return;
+    char row[ROW_MAX];
+    fwrite(row, 1, format_status_row(row, sizeof row), stdout);
+}
+
+// print header once at start
+static void print_header(void) {
+    if (g_quiet) return;
+    pthread_mutex_lock(&print_mtx);
+
+    // print top border line
+    printf("|");
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        printf("=============|");
+    }
+    printf("\n| ");
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        printf("%c           | ", label_for(i));
+    }
+    printf("\n|");
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        printf("=============|");
+    }
+    printf("\n");
+    print_status_locked();
+    pthread_mutex_unlock(&print_mtx);
+}
+
+// ----- philosopher functions ------
+
+// Row updates are flat-combined: a philosopher posts its change in its
+// own slot and tries print_mtx. Whoever gets it is the combiner: it
+// applies every pending change in slot order, one row per change, and
+// rescans until no slot is pending before writing the rows and
+// unlocking. A philosopher that misses the lock waits on its own slot
+// (spin, then futex) for a combiner to do its change and returns without
+// ever taking print_mtx. Each change still gets its own row, in the order
+// it was applied.
+enum { PUB_STATE, PUB_HOLD };
+
+#define PUB_SPINS 64        // polls of pending before sleeping
+
+typedef struct {
+    _Alignas(64) atomic_uint pending;
+    atomic_int sleeping;    // owner is in pub_sleep
+    int kind;               // PUB_*
+    int arg, held;          // state, or left/right and held
+}
+pub_slot_t;
+
+static pub_slot_t g_pub[NUM_PHILOSOPHERS];
+static char g_pub_out[4 * NUM_PHILOSOPHERS * ROW_MAX];  // under print_mtx
+static long g_pub_ops, g_pub_passes;                     // under print_mtx
+
+// applies one posted change: caller must hold print_mtx
+static void pub_apply_locked(int pid, const pub_slot_t *op) {
+    if (op->kind == PUB_STATE) {
+        state_t st = (state_t)op->arg;
+        if (st == ST_EATING) {
+            eaters_change_locked(1);
+        } else if (g_state[pid] == ST_EATING) {
+            eaters_change_locked(-1);
+        }
+        g_state[pid] = st;
+        TRACE(TRACE_STATE, pid, st);
+        return;
+    }
+    // traced here rather than at the fork, so the trace's hold bits
+    // change exactly when the ones a snapshot copies do
+    int fork = op->arg ? args[pid].left_fork : args[pid].right_fork;
+    TRACE(op->held ? TRACE_GRANT : TRACE_POST, pid, fork);
+    if (op->arg) {
+        g_hold_left[pid] = op->held;
+    } else {
+        g_hold_right[pid] = op->held;
+    }
+}
+
+static void pub_sleep(pub_slot_t *s) {
+#ifdef __linux__
+    // bounded, so a post that lands as the combiner unlocks is picked up
+    // by trying the lock again
+    const struct timespec limit = { 0, 1000000 };
+    atomic_store(&s->sleeping, 1);
+    syscall(SYS_futex, (unsigned *)&s->pending, FUTEX_WAIT_PRIVATE, 1,
+            &limit, NULL, 0);
+    atomic_store(&s->sleeping, 0);
+#else
+    (void)s;
+    sched_yield();
+#endif
+}
+
+static void pub_wake(pub_slot_t *s) {
+#ifdef __linux__
+    if (atomic_load(&s->sleeping)) {
+        syscall(SYS_futex, (unsigned *)&s->pending, FUTEX_WAKE_PRIVATE, 1,
+                NULL, NULL, 0);
+    }
+#else
+    (void)s;
+#endif
+}
+
+static int pub_any_pending(void) {
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        if (atomic_load(&g_pub[i].pending)) return 1;
+    }
+    return 0;
+}
+
+// applies changes until no slot is pending: caller must hold print_mtx
+static void pub_combine_locked(void) {
+    size_t out = 0;
+    long ops = g_pub_ops;
+    int found;
+    do {
+        found = 0;
+        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+            pub_slot_t *op = &g_pub[i];
+            if (!atomic_load_explicit(&op->pending, memory_order_acquire)) {
+                continue;
+            }
+            pub_apply_locked(i, op);
+            if (!g_quiet) {
+                if (sizeof g_pub_out - out < ROW_MAX) {
+                    fwrite(g_pub_out, 1, out, stdout);
+                    out = 0;
+                }
+                out += format_status_row(g_pub_out + out,
+                                         sizeof g_pub_out - out);
+            }
+            g_pub_ops++;
+            atomic_store(&op->pending, 0);
+            pub_wake(op);
+            found = 1;
+        }
+    } while (found);
+    if (g_pub_ops > ops) g_pub_passes++;
+    if (out > 0) fwrite(g_pub_out, 1, out, stdout);
+}
+
+static void pub_submit(int pid, int kind, int arg, int held) {
+    pub_slot_t *mine = &g_pub[pid];
+    mine->kind = kind;
+    mine->arg = arg;
+    mine->held = held;
+    atomic_store(&mine->pending, 1);
+
+    for (int spins = 0; atomic_load(&mine->pending); spins++) {
+        if (pthread_mutex_trylock(&print_mtx) == 0) {
+            // combine, and again if a post slipped in behind the unlock
+            // while nobody else holds the lock
+            do {
+                pub_combine_locked();
+                pthread_mutex_unlock(&print_mtx);
+            } while (pub_any_pending() &&
+                     pthread_mutex_trylock(&print_mtx) == 0);
+            return;
+        }
+        if (spins < PUB_SPINS) cpu_relax();
+        else pub_sleep(mine);
+    }
+}
+
+// sets a philosopher's state and prints the row (one change per line)
+static void publish_state(int pid, state_t st) {
+    if (g_explore) xp_park(pid, XP_PUBLISH, (int)st);
+    pub_submit(pid, PUB_STATE, (int)st, 0);
+    if (g_explore) xp_published(pid, st);
+}
+
+// sets whether a philosopher holds its left or right fork and prints the row
+static void publish_hold(int pid, int left, int held) {
+    if (g_explore) xp_park(pid, XP_HOLD, left ? -1 - held : 1 + held);
+    pub_submit(pid, PUB_HOLD, left, held);
+}
+
+static void print_publish_report(void) {
+    if (g_pub_passes == 0) return;
+    printf("publish: %ld row updates in %ld combining passes (%.2f per pass, "
+           "%.1f%% fewer print_mtx acquisitions)\n", g_pub_ops, g_pub_passes,
+           (double)g_pub_ops / (double)g_pub_passes,
+           100.0 * (1.0 - (double)g_pub_passes / (double)g_pub_ops));
+}
+
+// picks up the philosopher's first fork based on the specified order
+static void pick_first_fork(int pid, int first_is_left) {
+    int fork_idx;
+    if (first_is_left) {
+        fork_idx = args[pid].left_fork;
+    } else {
+        fork_idx = args[pid].right_fork;
+    }
+
+    // wait
+    fork_wait_idx(pid, fork_idx);
+
+    // update + print atomically (one change per line)
+    publish_hold(pid, first_is_left, 1);
+}
+
+// picks up the philosopher's second fork
+static void pick_second_fork(int pid, int first_is_left) {
+    int fork_idx;
+    if (first_is_left) {
+        fork_idx = args[pid].right_fork;
+    } else {
+        fork_idx = args[pid].left_fork;
+    }
+
+    fork_wait_idx(pid, fork_idx);
+
+    publish_hold(pid, !first_is_left, 1);
+}
+
+// releases one of the philosopher's forks
+static void put_down_one_fork(int pid, int left) {
+    int fork_idx;
+    if (left) {
+        fork_idx = args[pid].left_fork;
+    } else {
+        fork_idx = args[pid].right_fork;
+    }
+    publish_hold(pid, left, 0);
+
+    // post
+    fork_post_idx(pid, fork_idx);
+}
+
+// odd/even strategy to avoid deadlock:
+// even picks RIGHT first, odd picks LEFT first
+static int parity_first_is_left(int id, int n) {
+    (void)n;
+    return id % 2 != 0;
+}
+
+// resource ordering: everyone picks the lower-numbered fork first
+static int ordered_first_is_left(int id, int n) {
+    return id < (id + 1) % n;
+}
+
+static int always_left_first(int id, int n) {
+    (void)id;
+    (void)n;
+    return 1;
+}
+
+// acquisition strategies; the model checker builds its transitions
+// from this table too
+typedef struct {
+    const char *name;
+    int (*first_is_left)(int id, int n);
+    int seats;    // a waiter lets at most n-1 reach for forks at once
+}
+strategy_t;
+
+static const strategy_t strategies[] = {
+    { "parity",  parity_first_is_left,  0 },
+    { "ordered", ordered_first_is_left, 0 },
+    { "waiter",  always_left_first,     1 },
+};
+#define NUM_STRATEGIES ((int)(sizeof strategies / sizeof strategies[0]))
+
+static void *philosopher(void *vp) {
+    phil_arg_t *p = (phil_arg_t*)vp;
+    int id = p->id;
+
+    const strategy_t *st = &strategies[g_tune.strategy];
+    int left_first = st->first_is_left(id, NUM_PHILOSOPHERS);
+    pin_self(id);
+
+    while (p->cycles > 0 && !atomic_load_explicit(&g_stop, memory_order_relaxed)) {
+        if (g_max_hungry_ms) starve_defer(id);
+
+        // ---- acquire forks (changing) ----
+        publish_state(id, ST_CHANGING);
+        if (g_max_hungry_ms) starve_hungry(id);
+
+        unsigned epoch = 0;
+        if (g_adaptive) {
+            epoch = adapt_enter();
+            st = &strategies[atomic_load(&g_epoch_strategy[epoch & 1])];
+            left_first = st->first_is_left(id, NUM_PHILOSOPHERS);
+        }
+        long long hungry_since = g_adaptive || g_latency ? now_ns() : 0;
+
+        if (st->seats) seat_wait(id);
+        pick_first_fork(id, left_first);
+        pick_second_fork(id, left_first);
+
+        // ---- eat ----
+        publish_state(id, ST_EATING);
+        p->meals++;
+        meals_add(id);
+        if (g_max_hungry_ms) starve_fed(id);
+        if (g_adaptive || g_latency) {
+            long long hungry = now_ns() - hungry_since;
+            if (g_adaptive) adapt_after_meal(id, hungry);
+            if (g_latency) {
+                lat_record(id, hungry);
+                wait_add(id, hungry);
+            }
+        }
+        eat(id);
+        long long batch_since = g_batch_ms ? now_ns() : 0;
+        for (long k = 1; k < g_batch && p->cycles > 1 &&
+             !atomic_load_explicit(&g_stop, memory_order_relaxed); k++) {
+            if (forks_wanted(id) &&
+                now_ns() - batch_since >= g_batch_ms * 1000000LL) break;
+            if (g_max_hungry_ms && starve_neighbor(id)) break;
+            p->meals++;
+            meals_add(id);
+            p->cycles--;
+            eat(id);
+        }
+
+        // ---- transition to set forks down ----
+        publish_state(id, ST_CHANGING);
+
+        // put down one at a time
+        put_down_one_fork(id,  left_first);
+        put_down_one_fork(id, !left_first);
+        if (st->seats) seat_post(id);
+        if (g_adaptive) adapt_exit(epoch);
+
+        // think
+        publish_state(id, ST_THINKING);
+        dawdle(id, &g_profile[id].think);
+
+        // prepare next cycle
+        p->cycles--;
+    }
+
+    // transition from thinking to terminated counts as changing
+    publish_state(id, ST_CHANGING);
+    if (g_explore) xp_exit(id);
+    return NULL;
+}
+
+// ----- table setup -----
+
+// resets the display state and philosopher arguments for a fresh run;
+// a timed run (stopped by g_stop) gives everyone `cycles`, otherwise a
+// profile's cycle count takes precedence
+static void table_reset(long cycles, int timed) {
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        g_state[i] = ST_CHANGING;
+        g_hold_left[i] = 0;
+        g_hold_right[i] = 0;
+        args[i].id = i;
+        args[i].left_fork  = i;
+        args[i].right_fork = (i + 1) % NUM_PHILOSOPHERS;
+        args[i].cycles = (int)(g_profile[i].cycles > 0 && !timed ?
+                               g_profile[i].cycles : cycles);
+        args[i].meals = 0;
+    }
+    atomic_store(&g_eaters, 0);
+    atomic_store(&g_stop, 0);
+    g_pub_ops = g_pub_passes = 0;
+    meals_reset();
+    if (g_max_hungry_ms) starve_reset();
+    atomic_store(&g_preempted, 0);
+    atomic_store(&g_preempt_saved_ms, 0);
+    if (g_adaptive) adapt_reset();
+    if (g_latency) lat_reset();
+    // a sweep tracing across runs starts each one from a fresh snapshot
+    if (atomic_load(&g_trace_on)) atomic_fetch_add(&g_trace_gen, 1);
+}
+
+static void table_start(void) {
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        int rc = pthread_create(&tids[i], NULL, philosopher, &args[i]);
+        if (rc != 0) die_errno("pthread_create", rc);
+    }
+}
+
+static void table_join(void) {
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        int rc = pthread_join(tids[i], NULL);
+        if (rc != 0) die_errno("pthread_join", rc);
+    }
+}
+
+// --seek FILE: print the table as it stood at one point of a trace
+static const char *g_seek_path;
+static long g_seek_event = -1;          // --at N
+static long long g_seek_ns = -1;        // --at-ns NS
+
+// sets the display's table to a trace frame
+static void table_from_frame(const trace_frame_t *f) {
+    table_reset(1, 0);
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        g_state[i] = (state_t)f->state[i];
+        g_hold_left[i] = f->hold[i] & 1;
+        g_hold_right[i] = (f->hold[i] >> 1) & 1;
+    }
+}
+
+static int seek_main(void) {
+    trace_reader_t *r = trace_open(g_seek_path);
+    if (r == NULL) return 1;
+    if (trace_n(r) != NUM_PHILOSOPHERS) {
+        fprintf(stderr, "%s: traced %d philosophers, built for %d\n",
+                g_seek_path, trace_n(r), NUM_PHILOSOPHERS);
+        trace_close(r);
+        return 1;
+    }
+    trace_frame_t f;
+    int rc = g_seek_ns >= 0 ? trace_seek_time(r, g_seek_ns, &f)
+                            : trace_seek_event(r, g_seek_event >= 0 ?
+                                               g_seek_event : trace_count(r), &f);
+    if (rc != 0) {
+        fprintf(stderr, "%s: no such point (%ld events)\n", g_seek_path,
+                trace_count(r));
+        trace_close(r);
+        return 1;
+    }
+    printf("after event %ld of %ld, t = %.6f ms (%ld keyframes)\n", f.index,
+           trace_count(r), (double)f.ts / 1e6, trace_keyframes(r));
+    table_from_frame(&f);
+    g_quiet = 0;
+    print_header();
+    trace_close(r);
+    return 0;
+}
+
+// ----- interleaving explorer: scheduler -----
+// random mode picks uniformly among the runnable threads at every sync
+// point; dfs mode enumerates the choices depth-first, replaying a prefix
+// of the previous run and pruning branches out of already-seen states.
+// Work is split across forked worker processes, each with its own table.
+#define XP_MAX_STEPS 4096
+
+static long g_xp_runs;          // --runs: random runs (default 1000), or
+                                // a cap on dfs runs (default unlimited)
+static long g_xp_jobs;          // --jobs: worker processes, 0 = one per CPU
+static long g_xp_bound;         // --bound: max neighbor meals while hungry
+
+typedef struct {
+    unsigned enabled;   // threads that could move at this step
+    unsigned tried;     // alternatives explored or left to other workers
+    int chosen;
+}
+xp_choice_t;
+
+typedef struct {
+    long runs;
+    long states;        // distinct states hashed
+    long pruned;        // runs cut short by an already-seen state
+    int max_overtaken;
+    int complete;       // dfs exhausted its share of the tree
+    int failed;
+    char what[160];
+    char schedule[XP_MAX_STEPS + 1];   // who moved at each step
+}
+xp_result_t;
+
+static unsigned long long *xp_seen;    // open-addressed set of state hashes
+static size_t xp_seen_cap, xp_seen_len;
+
+// returns 1 if the hash was not in the set yet
+static int xp_seen_insert(unsigned long long h) {
+    if (h == 0) h = 1;
+    if (2 * (xp_seen_len + 1) > xp_seen_cap) {
+        size_t cap = xp_seen_cap ? 2 * xp_seen_cap : 1 << 16;
+        unsigned long long *tab = calloc(cap, sizeof *tab);
+        if (tab == NULL) {
+            perror("calloc");
+            exit(1);
+        }
+        for (size_t i = 0; i < xp_seen_cap; i++) {
+            if (xp_seen[i] == 0) continue;
+            size_t j = xp_seen[i] & (cap - 1);
+            while (tab[j] != 0) j = (j + 1) & (cap - 1);
+            tab[j] = xp_seen[i];
+        }
+        free(xp_seen);
+        xp_seen = tab;
+        xp_seen_cap = cap;
+    }
+    size_t j = h & (xp_seen_cap - 1);
+    while (xp_seen[j] != 0) {
+        if (xp_seen[j] == h) return 0;
+        j = (j + 1) & (xp_seen_cap - 1);
+    }
+    xp_seen[j] = h;
+    xp_seen_len++;
+    return 1;
+}
+
+static void xp_hash_mix(unsigned long long *h, long v) {
+    *h = (*h ^ (unsigned long long)v) * 1099511628211ULL;
+}
+
+// FNV-1a over everything that decides how the run can continue. With
+// --bound that includes each hungry thread's overtaken count, capped
+// just past the bound since the check fails there anyway.
+static unsigned long long xp_hash(void) {
+    unsigned long long h = 14695981039346656037ULL;
+    int free_seats = 0;
+    sem_getvalue(&seats, &free_seats);
+    xp_hash_mix(&h, free_seats);
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        const xp_thread_t *t = &xp_th[i];
+        xp_hash_mix(&h, t->done);
+        xp_hash_mix(&h, t->point);
+        xp_hash_mix(&h, t->arg);
+        xp_hash_mix(&h, t->blocked_on);
+        xp_hash_mix(&h, args[i].cycles);
+        xp_hash_mix(&h, g_state[i]);
+        xp_hash_mix(&h, g_hold_left[i] | g_hold_right[i] << 1);
+        xp_hash_mix(&h, xp_owner[i]);
+        if (g_xp_bound > 0) {
+            xp_hash_mix(&h, t->hungry);
+            xp_hash_mix(&h, t->overtaken <= g_xp_bound ? t->overtaken
+                                                        : g_xp_bound + 1);
+        }
+    }
+    return h;
+}
+
+// safety checks on the parked table
+static void xp_check(void) {
+    char msg[160];
+    for (int f = 0; f < NUM_PHILOSOPHERS; f++) {
+        int other = (f + NUM_PHILOSOPHERS - 1) % NUM_PHILOSOPHERS;
+        if (other != f && g_hold_left[f] && g_hold_right[other]) {
+            snprintf(msg, sizeof msg, "mutual exclusion: %c and %c both hold "
+                     "fork %d", 'A' + f, 'A' + other, f);
+            xp_fail(msg);
+        }
+        int next = (f + 1) % NUM_PHILOSOPHERS;
+        if (next != f && g_state[f] == ST_EATING && g_state[next] == ST_EATING) {
+            snprintf(msg, sizeof msg, "mutual exclusion: neighbors %c and %c "
+                     "both eating", 'A' + f, 'A' + next);
+            xp_fail(msg);
+        }
+    }
+    if (g_xp_bound > 0 && xp_max_overtaken > g_xp_bound) {
+        snprintf(msg, sizeof msg, "bounded waiting: a neighbor started %d "
+                 "meals while one philosopher stayed hungry (bound %ld)",
+                 xp_max_overtaken, g_xp_bound);
+        xp_fail(msg);
+    }
+}
+
+// the n-th (0-based) set bit of mask
+static int xp_nth_bit(unsigned mask, int n) {
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        if ((mask >> i & 1u) && n-- == 0) return i;
+    }
+    return -1;
+}
+
+// runs the table once under the scheduler. dfs replays stack[0..prefix)
+// and extends it up to *depth. Returns 0 when the run completed, 1 on a
+// violation (its threads stay parked), 2 when dfs found nothing left for
+// this worker.
+static int xp_run_once(long cycles, xp_choice_t *stack, int *depth,
+                       int prefix, int *split_at, unsigned *seed,
+                       int job, int jobs, xp_result_t *res) {
+    table_reset(cycles, 0);
+    forks_init_all();
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        xp_th[i] = (xp_thread_t){ .blocked_on = -1 };
+        xp_owner[i] = -1;
+    }
+    xp_violation[0] = '\0';
+    xp_max_overtaken = 0;
+    xp_running = NUM_PHILOSOPHERS;
+    xp_turn = -1;
+    table_start();
+
+    int steps = 0, free_run = 0, rc = 0;
+    pthread_mutex_lock(&xp_mtx);
+    for (;;) {
+        while (xp_running > 0) {
+            pthread_cond_wait(&xp_cv, &xp_mtx);
+        }
+        xp_check();
+        if (xp_max_overtaken > res->max_overtaken) {
+            res->max_overtaken = xp_max_overtaken;
+        }
+
+        unsigned enabled = 0;
+        int live = 0;
+        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+            if (xp_th[i].done) continue;
+            live++;
+            if (xp_th[i].blocked_on < 0) enabled |= 1u << i;
+        }
+        if (live == 0) break;
+        if (enabled == 0) {
+            xp_fail("deadlock: every remaining philosopher is blocked on a fork");
+        }
+        if (steps == XP_MAX_STEPS) {
+            xp_fail("step limit reached: livelock or too many cycles");
+        }
+        if (xp_violation[0] != '\0') {
+            rc = 1;
+            break;
+        }
+
+        int pick;
+        if (g_explore == XP_RANDOM) {
+            xp_seen_insert(xp_hash());
+            pick = xp_nth_bit(enabled, (int)(rand_r(seed) %
+                                       (unsigned)__builtin_popcount(enabled)));
+        } else if (steps < prefix) {
+            pick = stack[steps].chosen;
+            if (!(enabled >> pick & 1u)) {
+                xp_fail("nondeterministic replay: dfs prefix diverged");
+                rc = 1;
+                break;
+            }
+        } else if (free_run || !xp_seen_insert(xp_hash())) {
+            // everything after a seen state was explored from its first
+            // visit. The free run to the end doesn't mark what it passes:
+            // only states whose alternatives went on the stack count as seen
+            if (!free_run) res->pruned++;
+            free_run = 1;
+            pick = xp_nth_bit(enabled, 0);
+        } else {
+            xp_choice_t *c = &stack[steps];
+            c->enabled = enabled;
+            c->tried = 0;
+            if (jobs > 1 && *split_at < 0 && __builtin_popcount(enabled) > 1) {
+                // the first real choice is dealt round-robin to the workers
+                *split_at = steps;
+                for (int k = 0; k < __builtin_popcount(enabled); k++) {
+                    if (k % jobs != job) c->tried |= 1u << xp_nth_bit(enabled, k);
+                }
+                if (c->tried == enabled) {
+                    rc = 2;
+                    break;
+                }
+            }
+            pick = xp_nth_bit(enabled & ~c->tried, 0);
+            c->tried |= 1u << pick;
+            c->chosen = pick;
+            *depth = steps + 1;
+        }
+
+        res->schedule[steps++] = (char)('A' + pick);
+        res->schedule[steps] = '\0';
+        xp_running++;
+        xp_turn = pick;
+        pthread_cond_signal(&xp_go[pick]);
+    }
+    pthread_mutex_unlock(&xp_mtx);
+
+    if (rc == 1) {
+        snprintf(res->what, sizeof res->what, "%s", xp_violation);
+    }
+    if (rc != 0) return rc;  // parked threads die with the worker
+    table_join();
+    forks_destroy_all();
+    return 0;
+}
+
+static void xp_worker(long cycles, int job, int jobs, int fd) {
+    static xp_result_t res;
+    static xp_choice_t stack[XP_MAX_STEPS];
+    unsigned seed = (unsigned)(now_ns() ^ (long long)job * 2654435761LL);
+    long limit = g_xp_runs / jobs + (job < g_xp_runs % jobs);
+    int depth = 0, prefix = 0, split_at = -1;
+
+    while (res.runs < limit) {
+        int rc = xp_run_once(cycles, stack, &depth, prefix, &split_at, &seed,
+                             job, jobs, &res);
+        if (rc == 2) {
+            res.complete = 1;
+            break;
+        }
+        res.runs++;
+        if (rc == 1) {
+            res.failed = 1;
+            break;
+        }
+        if (g_explore != XP_DFS) continue;
+
+        // backtrack to the deepest choice with an untried alternative
+        while (depth > 0 && stack[depth - 1].tried == stack[depth - 1].enabled) {
+            depth--;
+        }
+        if (depth == 0) {
+            res.complete = 1;
+            break;
+        }
+        xp_choice_t *c = &stack[depth - 1];
+        c->chosen = xp_nth_bit(c->enabled & ~c->tried, 0);
+        c->tried |= 1u << c->chosen;
+        prefix = depth;
+        if (split_at >= depth) split_at = -1;
+    }
+    res.states = (long)xp_seen_len;
+
+    const char *buf = (const char *)&res;
+    size_t left = sizeof res;
+    while (left > 0) {
+        ssize_t n = write(fd, buf, left);
+        if (n <= 0) break;
+        buf += n;
+        left -= (size_t)n;
+    }
+    _exit(0);
+}
+
+// --explore: fork the workers, merge their results, report
+static int explore_main(long cycles) {
+    long jobs = g_xp_jobs;
+#ifdef _SC_NPROCESSORS_ONLN
+    if (jobs <= 0) jobs = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (jobs <= 0) jobs = 1;
+    if (g_xp_runs == 0) g_xp_runs = g_explore == XP_DFS ? LONG_MAX : 1000;
+    if (NUM_PHILOSOPHERS > 32) {
+        fprintf(stderr, "explore: at most 32 philosophers are supported\n");
+        return 1;
+    }
+    g_quiet = 1;
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        pthread_cond_init(&xp_go[i], NULL);
+    }
+
+    printf("explore: %s, %d philosophers, %ld cycle(s), %ld job(s)\n",
+           g_explore == XP_DFS ? "dfs" : "random", NUM_PHILOSOPHERS, cycles,
+           jobs);
+    fflush(stdout);
+
+    long long t0 = now_ns();
+    int fds[64];
+    pid_t pids[64];
+    if (jobs > 64) jobs = 64;
+    for (int j = 0; j < jobs; j++) {
+        int pfd[2];
+        if (pipe(pfd) == -1) {
+            perror("pipe");
+            return 1;
+        }
+        pids[j] = fork();
+        if (pids[j] == -1) {
+            perror("fork");
+            return 1;
+        }
+        if (pids[j] == 0) {
+            close(pfd[0]);
+            xp_worker(cycles, j, (int)jobs, pfd[1]);
+        }
+        close(pfd[1]);
+        fds[j] = pfd[0];
+    }
+
+    static xp_result_t res, sum;
+    int failed = 0, complete = 1;
+    for (int j = 0; j < jobs; j++) {
+        char *buf = (char *)&res;
+        size_t got = 0;
+        while (got < sizeof res) {
+            ssize_t n = read(fds[j], buf + got, sizeof res - got);
+            if (n <= 0) break;
+            got += (size_t)n;
+        }
+        close(fds[j]);
+        waitpid(pids[j], NULL, 0);
+        if (got < sizeof res) {
+            fprintf(stderr, "explore: worker %d died\n", j);
+            failed = 1;
+            continue;
+        }
+        sum.runs += res.runs;
+        sum.states += res.states;
+        sum.pruned += res.pruned;
+        if (res.max_overtaken > sum.max_overtaken) {
+            sum.max_overtaken = res.max_overtaken;
+        }
+        complete &= res.complete;
+        if (res.failed && !failed) {
+            failed = 1;
+            printf("VIOLATION (worker %d, run %ld): %s\n", j, res.runs, res.what);
+            printf("schedule: %s\n", res.schedule);
+        }
+    }
+    double secs = (double)(now_ns() - t0) / 1e9;
+
+    printf("runs %ld in %.2f s (%.0f/s), %ld states hashed, %ld runs pruned\n",
+           sum.runs, secs, secs > 0 ? (double)sum.runs / secs : 0.0,
+           sum.states, sum.pruned);
+    printf("max neighbor meals while hungry: %d%s\n", sum.max_overtaken,
+           g_xp_bound > 0 ? "" : " (no --bound set)");
+    if (g_explore == XP_DFS && !failed) {
+        printf("search %s\n", complete ? "exhaustive" : "truncated by --runs");
+    }
+    printf("%s\n", failed ? "FAILED" : "no violations found");
+    return failed;
+}
+
+// ----- trace renderer -----
+
+// --render FILE: turns a trace back into the table's rows, after the
+// run. Every keyframe starts an independent stretch of rows (a chunk);
+// --jobs threads take chunks in order and render each into a slot of a
+// small ring, with the live display's row layout. The main thread
+// writes finished chunks out in order with writev and hands the slots
+// back, so at most RENDER_AHEAD chunks per thread sit in memory.
+#define RENDER_AHEAD 4
+
+static const char *g_render_path;
+
+typedef struct {
+    char *out;
+    size_t len, cap;
+    long rows;
+    int done;               // 0 free/busy, 1 rendered, -1 seek failed
+}
+render_slot_t;
+
+static pthread_mutex_t render_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t render_cv = PTHREAD_COND_INITIALIZER;
+static render_slot_t *g_render_ring;
+static long g_render_slots;
+static long g_render_chunks;
+static long g_render_next;     // next chunk to hand out
+static long g_render_written;  // chunks already written
+static int g_render_stop;
+
+// renders chunk k (keyframe k up to keyframe k + 1) into s; -1 if the
+// reader can't get there or the events stop short
+static int render_chunk(trace_reader_t *r, long k, render_slot_t *s) {
+    long to = k + 1 < g_render_chunks ? trace_keyframe_event(r, k + 1)
+                                      : trace_count(r);
+    trace_frame_t f;
+    if (trace_seek_event(r, trace_keyframe_event(r, k), &f) != 0) return -1;
+    state_t state[NUM_PHILOSOPHERS];
+    int left[NUM_PHILOSOPHERS], right[NUM_PHILOSOPHERS];
+    trace_event_t ev;
+    s->len = 0;
+    s->rows = 0;
+    while (f.index < to && trace_next(r, &f, &ev)) {
+        if (ev.kind == TRACE_WAIT) continue;  // the display has no row for it
+        if (s->cap - s->len < ROW_MAX) {
+            size_t cap = s->cap ? 2 * s->cap : 1 << 16;
+            char *grown = realloc(s->out, cap);
+            if (grown == NULL) {
+                perror("realloc");
+                exit(1);
+            }
+            s->out = grown;
+            s->cap = cap;
+        }
+        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+            state[i] = (state_t)f.state[i];
+            left[i] = f.hold[i] & 1;
+            right[i] = (f.hold[i] >> 1) & 1;
+        }
+        s->len += format_row(s->out + s->len, s->cap - s->len, state, left, right);
+        s->rows++;
+    }
+    return f.index < to ? -1 : 0;
+}
+
+static void *render_worker(void *vp) {
+    trace_reader_t *r = (trace_reader_t *)vp;
+    for (;;) {
+        pthread_mutex_lock(&render_mtx);
+        // chunk k reuses the slot of chunk k - slots: wait until it's out
+        while (!g_render_stop && g_render_next < g_render_chunks &&
+               g_render_next >= g_render_written + g_render_slots) {
+            pthread_cond_wait(&render_cv, &render_mtx);
+        }
+        if (g_render_stop || g_render_next >= g_render_chunks) {
+            pthread_mutex_unlock(&render_mtx);
+            return NULL;
+        }
+        long k = g_render_next++;
+        pthread_mutex_unlock(&render_mtx);
+
+        render_slot_t *s = &g_render_ring[k % g_render_slots];
+        int rc = render_chunk(r, k, s);
+        pthread_mutex_lock(&render_mtx);
+        s->done = rc == 0 ? 1 : -1;
+        pthread_cond_broadcast(&render_cv);
+        pthread_mutex_unlock(&render_mtx);
+    }
+}
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+// writes iov[0..n) in full; writev may stop short, so step past what
+// went out and retry
+static int write_iov(struct iovec *iov, int n) {
+    int first = 0;
+    while (first < n) {
+        ssize_t put = writev(STDOUT_FILENO, iov + first, n - first);
+        if (put < 0) {
+            if (errno == EINTR) continue;
+            perror("writev");
+            return -1;
+        }
+        while (first < n && (size_t)put >= iov[first].iov_len) {
+            put -= (ssize_t)iov[first++].iov_len;
+        }
+        if (first < n) {
+            iov[first].iov_base = (char *)iov[first].iov_base + put;
+            iov[first].iov_len -= (size_t)put;
+        }
+    }
+    return 0;
+}
+
+static int render_main(void) {
+    trace_reader_t *r = trace_open(g_render_path);
+    if (r == NULL) return 1;
+    if (trace_n(r) != NUM_PHILOSOPHERS) {
+        fprintf(stderr, "%s: traced %d philosophers, built for %d\n",
+                g_render_path, trace_n(r), NUM_PHILOSOPHERS);
+        trace_close(r);
+        return 1;
+    }
+    long jobs = g_xp_jobs > 0 ? g_xp_jobs : sysconf(_SC_NPROCESSORS_ONLN);
+    g_render_chunks = trace_keyframes(r);
+    if (jobs < 1) jobs = 1;
+    if (jobs > g_render_chunks) jobs = g_render_chunks;
+    g_render_slots = jobs * RENDER_AHEAD;
+    if (g_render_slots > IOV_MAX) g_render_slots = IOV_MAX;
+
+    // the first row is the table at keyframe 0, which a trace started
+    // mid-run need not have all blank; the rows name forks through
+    // args[], so this goes before the workers start
+    trace_frame_t start;
+    if (trace_seek_event(r, 0, &start) != 0) {
+        fprintf(stderr, "%s: can't read keyframe 0\n", g_render_path);
+        trace_close(r);
+        return 1;
+    }
+    table_from_frame(&start);
+    long long t0 = now_ns();
+    g_render_ring = calloc((size_t)g_render_slots, sizeof *g_render_ring);
+    pthread_t *tids = calloc((size_t)jobs, sizeof *tids);
+    trace_reader_t **readers = calloc((size_t)jobs, sizeof *readers);
+    if (g_render_ring == NULL || tids == NULL || readers == NULL) {
+        perror("calloc");
+        return 1;
+    }
+    for (long j = 0; j < jobs; j++) {
+        readers[j] = trace_dup(r);
+        if (readers[j] == NULL) return 1;
+        int rc = pthread_create(&tids[j], NULL, render_worker, readers[j]);
+        if (rc != 0) die_errno("pthread_create", rc);
+    }
+
+    // header and initial row while the workers run
+    g_quiet = 0;
+    print_header();
+    fflush(stdout);
+
+    // write each run of finished chunks at the head of the ring in one go
+    struct iovec iov[IOV_MAX];
+    long rows = 0;
+    int failed = 0;
+    while (!failed && g_render_written < g_render_chunks) {
+        pthread_mutex_lock(&render_mtx);
+        while (g_render_ring[g_render_written % g_render_slots].done == 0) {
+            pthread_cond_wait(&render_cv, &render_mtx);
+        }
+        long k = g_render_written, end = k;
+        while (end < g_render_chunks && end - k < g_render_slots &&
+               g_render_ring[end % g_render_slots].done == 1) {
+            end++;
+        }
+        if (end == k) {
+            fprintf(stderr, "%s: can't read the events from %ld on\n",
+                    g_render_path, trace_keyframe_event(r, k));
+            failed = 1;
+        }
+        pthread_mutex_unlock(&render_mtx);
+
+        int n = 0;
+        for (long c = k; c < end; c++) {
+            render_slot_t *s = &g_render_ring[c % g_render_slots];
+            rows += s->rows;
+            if (s->len == 0) continue;
+            iov[n].iov_base = s->out;
+            iov[n].iov_len = s->len;
+            n++;
+        }
+        if (n > 0 && write_iov(iov, n) != 0) failed = 1;
+
+        pthread_mutex_lock(&render_mtx);
+        for (long c = k; c < end; c++) g_render_ring[c % g_render_slots].done = 0;
+        g_render_written = end;
+        if (failed) g_render_stop = 1;
+        pthread_cond_broadcast(&render_cv);
+        pthread_mutex_unlock(&render_mtx);
+    }
+    for (long j = 0; j < jobs; j++) {
+        pthread_join(tids[j], NULL);
+        trace_close(readers[j]);
+    }
+    for (long s = 0; s < g_render_slots; s++) free(g_render_ring[s].out);
+    free(g_render_ring);
+    free(readers);
+    free(tids);
+
+    if (!failed) {
+        printf("|");
+        for (int i = 0; i < NUM_PHILOSOPHERS; i++) printf("=============|");
+        printf("\n");
+        fflush(stdout);
+        fprintf(stderr, "rendered %ld rows from %ld events in %.3f ms, "
+                "%ld chunk%s on %ld thread%s\n", rows, trace_count(r),
+                (double)(now_ns() - t0) / 1e6, g_render_chunks,
+                g_render_chunks == 1 ? "" : "s", jobs, jobs == 1 ? "" : "s");
+    }
+    trace_close(r);
+    return failed;
+}
+
+// ----- explicit-state model checker -----
+// --check N enumerates every reachable state of the acquisition protocol
+// for N philosophers. A state packs, per philosopher, a program counter
+// and its two hold bits (5 bits) and, per fork, a taken bit, into 64 bits.
+// Workers expand states from work-stealing deques into a lock-free
+// visited set; afterwards a parallel backward fixpoint finds, for each
+// philosopher, the states from which it can still get to eat.
+enum { MC_THINK, MC_WANT1, MC_WANT2, MC_EAT, MC_PUT1, MC_PUT2, MC_SEAT };
+
+#define MC_MAX_N 10
+#define MC_EMPTY 0ULL
+
+typedef unsigned long long mc_state_t;
+
+typedef struct {
+    pthread_mutex_t mtx;
+    size_t *items;      // slot indices; owner works the tail, thieves the head
+    size_t head, tail, cap;
+}
+mc_deque_t;
+
+static long g_mc_n;                      // --check N
+static long g_mc_log2 = 22;              // --check-slots: log2 table size
+static const strategy_t *mc_strat;
+static _Atomic mc_state_t *mc_table;     // state + 1, or MC_EMPTY
+static unsigned *mc_parent;              // slot it was first reached from
+static atomic_uint *mc_marks;            // bit i: philosopher i can still eat
+static size_t mc_mask;
+static mc_deque_t mc_deques[64];
+static int mc_jobs;
+static atomic_long mc_pending;           // states queued but not expanded
+static atomic_long mc_states, mc_edges;
+static atomic_long mc_bad_slot;          // first deadlock or invariant failure
+static atomic_int mc_full;
+static char mc_bad_what[128];
+
+static int mc_pc(mc_state_t s, int i) { return (int)(s >> (5 * i) & 7); }
+static int mc_holds(mc_state_t s, int i, int left) {
+    return (int)(s >> (5 * i + (left ? 3 : 4)) & 1);
+}
+static int mc_taken(mc_state_t s, int f) {
+    return (int)(s >> (5 * g_mc_n + f) & 1);
+}
+
+static mc_state_t mc_set_pc(mc_state_t s, int i, int pc) {
+    return (s & ~(7ULL << (5 * i))) | (mc_state_t)pc << (5 * i);
+}
+
+// moves fork f to (held = 1) or from philosopher i's left or right hand
+static mc_state_t mc_move_fork(mc_state_t s, int i, int left, int held) {
+    int f = left ? i : (i + 1) % (int)g_mc_n;
+    mc_state_t hb = 1ULL << (5 * i + (left ? 3 : 4));
+    mc_state_t tb = 1ULL << (5 * g_mc_n + f);
+    return held ? (s | hb | tb) : (s & ~hb & ~tb);
+}
+
+static int mc_fork_free(mc_state_t s, int i, int left) {
+    return !mc_taken(s, left ? i : (i + 1) % (int)g_mc_n);
+}
+
+// philosophers holding a waiter's seat
+static int mc_seated(mc_state_t s) {
+    int seated = 0;
+    for (int i = 0; i < g_mc_n; i++) {
+        int pc = mc_pc(s, i);
+        seated += pc != MC_THINK && pc != MC_SEAT;
+    }
+    return seated;
+}
+
+// successors of s, one per philosopher that can move; returns the count
+static int mc_successors(mc_state_t s, mc_state_t *out) {
+    int n = 0;
+    for (int i = 0; i < g_mc_n; i++) {
+        int lf = mc_strat->first_is_left(i, (int)g_mc_n);
+        switch (mc_pc(s, i)) {
+        case MC_THINK:
+            out[n++] = mc_set_pc(s, i, mc_strat->seats ? MC_SEAT : MC_WANT1);
+            break;
+        case MC_SEAT:
+            if (mc_seated(s) < g_mc_n - 1) out[n++] = mc_set_pc(s, i, MC_WANT1);
+            break;
+        case MC_WANT1:
+            if (mc_fork_free(s, i, lf)) {
+                out[n++] = mc_set_pc(mc_move_fork(s, i, lf, 1), i, MC_WANT2);
+            }
+            break;
+        case MC_WANT2:
+            if (mc_fork_free(s, i, !lf)) {
+                out[n++] = mc_set_pc(mc_move_fork(s, i, !lf, 1), i, MC_EAT);
+            }
+            break;
+        case MC_EAT:
+            out[n++] = mc_set_pc(s, i, MC_PUT1);
+            break;
+        case MC_PUT1:
+            out[n++] = mc_set_pc(mc_move_fork(s, i, lf, 0), i, MC_PUT2);
+            break;
+        default:
+            out[n++] = mc_set_pc(mc_move_fork(s, i, !lf, 0), i, MC_THINK);
+            break;
+        }
+    }
+    return n;
+}
+
+// ownership consistency and neighbor exclusion; NULL when s is fine
+static const char *mc_invariant(mc_state_t s) {
+    const int n = (int)g_mc_n;
+    for (int f = 0; f < n; f++) {
+        int holders = mc_holds(s, f, 1) + mc_holds(s, (f + n - 1) % n, 0);
+        if (holders > 1) return "fork held by both neighbors";
+        if (holders != mc_taken(s, f)) return "fork ownership bit out of sync";
+    }
+    for (int i = 0; i < n; i++) {
+        if (mc_pc(s, i) != MC_EAT) continue;
+        if (!mc_holds(s, i, 1) || !mc_holds(s, i, 0)) {
+            return "eating without both forks";
+        }
+        if (mc_pc(s, (i + 1) % n) == MC_EAT) return "neighbors eating together";
+    }
+    return NULL;
+}
+
+static size_t mc_hash(mc_state_t s) {
+    s ^= s >> 33;
+    s *= 0xff51afd7ed558ccdULL;
+    s ^= s >> 33;
+    return (size_t)s & mc_mask;
+}
+
+// inserts s; returns its slot and whether this call added it
+static size_t mc_insert(mc_state_t s, int *added) {
+    mc_state_t key = s + 1;
+    size_t j = mc_hash(s);
+    *added = 0;
+    for (size_t probes = 0; probes <= mc_mask; probes++) {
+        mc_state_t cur = atomic_load_explicit(&mc_table[j], memory_order_acquire);
+        if (cur == MC_EMPTY) {
+            mc_state_t expect = MC_EMPTY;
+            if (atomic_compare_exchange_strong(&mc_table[j], &expect, key)) {
+                *added = 1;
+                return j;
+            }
+            cur = expect;
+        }
+        if (cur == key) return j;
+        j = (j + 1) & mc_mask;
+    }
+    atomic_store(&mc_full, 1);
+    return 0;
+}
+
+static size_t mc_lookup(mc_state_t s) {
+    size_t j = mc_hash(s);
+    while (atomic_load_explicit(&mc_table[j], memory_order_relaxed) != s + 1) {
+        j = (j + 1) & mc_mask;
+    }
+    return j;
+}
+
+static void mc_push(mc_deque_t *d, size_t slot) {
+    pthread_mutex_lock(&d->mtx);
+    if (d->tail == d->cap) {
+        // compact, then grow if still full
+        memmove(d->items, d->items + d->head, (d->tail - d->head) * sizeof *d->items);
+        d->tail -= d->head;
+        d->head = 0;
+        if (d->tail == d->cap) {
+            size_t cap = d->cap ? 2 * d->cap : 4096;
+            size_t *p = realloc(d->items, cap * sizeof *p);
+            if (p == NULL) {
+                perror("realloc");
+                exit(1);
+            }
+            d->items = p;
+            d->cap = cap;
+        }
+    }
+    d->items[d->tail++] = slot;
+    pthread_mutex_unlock(&d->mtx);
+}
+
+// pops from the owner's end, or steals from the other end
+static int mc_pop(mc_deque_t *d, int steal, size_t *slot) {
+    int ok = 0;
+    pthread_mutex_lock(&d->mtx);
+    if (d->head < d->tail) {
+        *slot = steal ? d->items[d->head++] : d->items[--d->tail];
+        ok = 1;
+    }
+    pthread_mutex_unlock(&d->mtx);
+    return ok;
+}
+
+static void mc_flag(size_t slot, const char *what) {
+    long expect = -1;
+    if (atomic_compare_exchange_strong(&mc_bad_slot, &expect, (long)slot)) {
+        snprintf(mc_bad_what, sizeof mc_bad_what, "%s", what);
+    }
+}
+
+static void *mc_explore_worker(void *vp) {
+    const int me = (int)(long)vp;
+    mc_state_t succ[MC_MAX_N];
+    size_t slot;
+
+    while (atomic_load(&mc_pending) > 0 && !atomic_load(&mc_full)) {
+        int got = mc_pop(&mc_deques[me], 0, &slot);
+        for (int k = 1; !got && k < mc_jobs; k++) {
+            got = mc_pop(&mc_deques[(me + k) % mc_jobs], 1, &slot);
+        }
+        if (!got) {
+            sched_yield();
+            continue;
+        }
+
+        mc_state_t s = atomic_load(&mc_table[slot]) - 1;
+        const char *bad = mc_invariant(s);
+        if (bad != NULL) mc_flag(slot, bad);
+        int ns = mc_successors(s, succ);
+        if (ns == 0) mc_flag(slot, "deadlock: nobody can move");
+        atomic_fetch_add(&mc_edges, ns);
+        for (int k = 0; k < ns; k++) {
+            int added;
+            size_t to = mc_insert(succ[k], &added);
+            if (!added) continue;
+            mc_parent[to] = (unsigned)slot;
+            atomic_fetch_add(&mc_states, 1);
+            atomic_fetch_add(&mc_pending, 1);
+            mc_push(&mc_deques[me], to);
+        }
+        atomic_fetch_sub(&mc_pending, 1);
+    }
+    return NULL;
+}
+
+static atomic_int mc_changed;
+
+// one sweep of the fixpoint over this worker's stripe of the table
+static void *mc_mark_worker(void *vp) {
+    const int me = (int)(long)vp;
+    const unsigned all = (1u << g_mc_n) - 1;
+    mc_state_t succ[MC_MAX_N];
+
+    for (size_t j = (size_t)me; j <= mc_mask; j += (size_t)mc_jobs) {
+        mc_state_t key = atomic_load_explicit(&mc_table[j], memory_order_relaxed);
+        if (key == MC_EMPTY) continue;
+        unsigned have = atomic_load_explicit(&mc_marks[j], memory_order_relaxed);
+        if (have == all) continue;
+
+        mc_state_t s = key - 1;
+        unsigned add = 0;
+        for (int i = 0; i < g_mc_n; i++) {
+            if (mc_pc(s, i) == MC_EAT) add |= 1u << i;
+        }
+        int ns = mc_successors(s, succ);
+        for (int k = 0; k < ns && (have | add) != all; k++) {
+            add |= atomic_load_explicit(&mc_marks[mc_lookup(succ[k])],
+                                        memory_order_relaxed);
+        }
+        if ((have | add) != have) {
+            atomic_fetch_or(&mc_marks[j], add);
+            atomic_store_explicit(&mc_changed, 1, memory_order_relaxed);
+        }
+    }
+    return NULL;
+}
+
+static void mc_run_workers(void *(*fn)(void *)) {
+    pthread_t th[64];
+    for (long j = 0; j < mc_jobs; j++) {
+        int rc = pthread_create(&th[j], NULL, fn, (void *)j);
+        if (rc != 0) die_errno("pthread_create", rc);
+    }
+    for (int j = 0; j < mc_jobs; j++) {
+        pthread_join(th[j], NULL);
+    }
+}
+
+static void mc_print_state(mc_state_t s) {
+    static const char code[] = "TH1ER2S";
+    printf("    ");
+    for (int i = 0; i < g_mc_n; i++) {
+        printf("%c:%c ", 'A' + i, code[mc_pc(s, i)]);
+    }
+    printf("\n");
+}
+
+// prints the path from the initial state to slot
+static void mc_print_trace(size_t slot, size_t root) {
+    size_t path[4096];
+    int len = 0;
+    for (size_t j = slot; len < 4096; j = mc_parent[j]) {
+        path[len++] = j;
+        if (j == root) break;
+    }
+    if (len == 4096) printf("    (trace truncated)\n");
+    while (len-- > 0) mc_print_state(atomic_load(&mc_table[path[len]]) - 1);
+}
+
+// checks one strategy; returns 0 if it passed
+static int mc_check_strategy(const strategy_t *st) {
+    mc_strat = st;
+    memset((void *)mc_table, 0, (mc_mask + 1) * sizeof *mc_table);
+    memset((void *)mc_marks, 0, (mc_mask + 1) * sizeof *mc_marks);
+    atomic_store(&mc_states, 1);
+    atomic_store(&mc_edges, 0);
+    atomic_store(&mc_pending, 1);
+    atomic_store(&mc_bad_slot, -1);
+    atomic_store(&mc_full, 0);
+
+    int added;
+    size_t root = mc_insert(0, &added);  // everyone thinking, forks free
+    mc_parent[root] = (unsigned)root;
+    mc_push(&mc_deques[0], root);
+
+    long long t0 = now_ns();
+    mc_run_workers(mc_explore_worker);
+    double secs = (double)(now_ns() - t0) / 1e9;
+    for (int j = 0; j < mc_jobs; j++) {
+        mc_deques[j].head = mc_deques[j].tail = 0;
+    }
+    if (atomic_load(&mc_full)) {
+        printf("%-10s state table full; raise --check-slots\n", st->name);
+        return 1;
+    }
+
+    long states = atomic_load(&mc_states);
+    printf("%-10s %ld states, %ld transitions in %.3f s (%.0f states/s)\n",
+           st->name, states, (long)atomic_load(&mc_edges), secs,
+           secs > 0 ? (double)states / secs : 0.0);
+
+    long bad = atomic_load(&mc_bad_slot);
+    if (bad >= 0) {
+        printf("%-10s FAILED: %s, reached by\n", "", mc_bad_what);
+        mc_print_trace((size_t)bad, root);
+        return 1;
+    }
+
+    // least fixpoint of "can reach a state where i eats"
+    int rounds = 0;
+    do {
+        atomic_store(&mc_changed, 0);
+        mc_run_workers(mc_mark_worker);
+        rounds++;
+    } while (atomic_load(&mc_changed));
+
+    int starving = 0;
+    for (int i = 0; i < g_mc_n; i++) {
+        for (size_t j = 0; j <= mc_mask; j++) {
+            mc_state_t key = atomic_load(&mc_table[j]);
+            if (key == MC_EMPTY || (atomic_load(&mc_marks[j]) >> i & 1)) continue;
+            int pc = mc_pc(key - 1, i);
+            if (pc != MC_WANT1 && pc != MC_WANT2 && pc != MC_SEAT) continue;
+            printf("%-10s FAILED: %c is hungry and can never eat again after\n",
+                   "", 'A' + i);
+            mc_print_trace(j, root);
+            starving = 1;
+            break;
+        }
+    }
+    if (starving) return 1;
+    printf("%-10s no deadlock; every hungry philosopher can still eat "
+           "(%d fixpoint rounds)\n", "", rounds);
+    return 0;
+}
+
+// --check: run the model checker over every strategy
+static int check_main(void) {
+    long jobs = g_xp_jobs;
+#ifdef _SC_NPROCESSORS_ONLN
+    if (jobs <= 0) jobs = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (jobs <= 0) jobs = 1;
+    if (jobs > 64) jobs = 64;
+    mc_jobs = (int)jobs;
+
+    size_t slots = (size_t)1 << g_mc_log2;
+    mc_mask = slots - 1;
+    mc_table = malloc(slots * sizeof *mc_table);
+    mc_parent = malloc(slots * sizeof *mc_parent);
+    mc_marks = malloc(slots * sizeof *mc_marks);
+    if (mc_table == NULL || mc_parent == NULL || mc_marks == NULL) {
+        perror("malloc");
+        return 1;
+    }
+    for (int j = 0; j < mc_jobs; j++) {
+        pthread_mutex_init(&mc_deques[j].mtx, NULL);
+    }
+
+    printf("check: %ld philosophers, %d job(s), %zu state slots\n",
+           g_mc_n, mc_jobs, slots);
+    printf("state codes: T think, S waiting for a seat, H hungry, "
+           "1 first fork, E eat, R releasing, 2 one fork left\n");
+    int failed = 0;
+    for (int k = 0; k < NUM_STRATEGIES; k++) {
+        failed |= mc_check_strategy(&strategies[k]);
+    }
+    return failed;
+}
+
+// ----- batch Monte Carlo -----
+// --simulate T runs T independent randomized tables in 1 ms ticks,
+// SIM_LANES tables at a time in one vector: each table's eating set,
+// hold bits and taken forks are N-bit masks in its lane, neighbor
+// conflicts over a fork are resolved with rotate/AND on those masks, and
+// durations come from a per-lane xorshift. Like the threaded table it
+// uses parity fork order and uniform 0..--dawdle ms think/eat times.
+#define SIM_LANES 4   // 128-bit vectors: SSE2 and NEON baseline
+#define SIM_HIST 4096   // hungry-time histogram, 1 ms buckets
+// meals and eaters gain at most N/2 a tick per 32-bit lane: move them
+// into the 64-bit totals well before they can wrap
+#define SIM_FLUSH_TICKS ((long)((1LL << 31) / NUM_PHILOSOPHERS))
+
+typedef unsigned sim_vec_t __attribute__((vector_size(SIM_LANES * sizeof(unsigned))));
+typedef unsigned long long sim_wide_t
+    __attribute__((vector_size(SIM_LANES * sizeof(unsigned long long))));
+
+static long g_sim_tables;        // --simulate T
+static long g_sim_ticks = 100000; // --ticks: simulated ms per table
+
+typedef struct {
+    long long meals;
+    long long eater_ticks;       // summed eaters per tick (concurrency)
+    long long hist[SIM_HIST + 1]; // last bucket collects longer waits
+    long long max_wait;
+}
+sim_result_t;
+
+static pthread_mutex_t sim_mtx = PTHREAD_MUTEX_INITIALIZER;
+static sim_result_t sim_total;
+static long long *sim_table_meals; // per table, for the spread
+static atomic_long sim_next_block;
+
+static unsigned sim_full_mask(void) {
+    return NUM_PHILOSOPHERS == 32 ? ~0u : (1u << NUM_PHILOSOPHERS) - 1;
+}
+
+// rotate an N-bit ring mask by one toward higher / lower positions
+static sim_vec_t sim_rotl(sim_vec_t x) {
+    return ((x << 1) | (x >> (NUM_PHILOSOPHERS - 1))) & sim_full_mask();
+}
+static sim_vec_t sim_rotr(sim_vec_t x) {
+    return ((x >> 1) | (x << (NUM_PHILOSOPHERS - 1))) & sim_full_mask();
+}
+
+// next 0..--dawdle duration per lane
+static sim_vec_t sim_sample(sim_vec_t *rng) {
+    sim_vec_t x = *rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *rng = x;
+    // 16 random bits times --dawdle + 1 needs up to 47 bits: widen lanes
+    sim_wide_t wide = __builtin_convertvector(x >> 16, sim_wide_t);
+    wide = (wide * (unsigned long long)(g_dawdle_ms + 1)) >> 16;
+    return __builtin_convertvector(wide, sim_vec_t);
+}
+
+// all-ones in lanes where bit i of mask is set
+static sim_vec_t sim_has(sim_vec_t mask, int i) {
+    return (sim_vec_t)(((mask >> i) & 1) != 0);
+}
+
+static void sim_block(long first, int lanes, sim_result_t *r) {
+    const unsigned full = sim_full_mask();
+    unsigned left_first = 0;
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        if (parity_first_is_left(i, NUM_PHILOSOPHERS)) left_first |= 1u << i;
+    }
+
+    sim_vec_t zero = { 0 };
+    sim_vec_t think = zero + full, hungry = zero, eat = zero;
+    sim_vec_t hl = zero, hr = zero, taken = zero, lf = zero + left_first;
+    sim_vec_t timer[NUM_PHILOSOPHERS], wait[NUM_PHILOSOPHERS];
+    sim_vec_t meals = zero, eaters = zero, rng;
+    long long meals_sum[SIM_LANES] = { 0 }, eaters_sum[SIM_LANES] = { 0 };
+    for (int k = 0; k < SIM_LANES; k++) {
+        rng[k] = (unsigned)((first + k + 1) * 2654435761u) | 1u;
+    }
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        timer[i] = sim_sample(&rng);
+        wait[i] = zero;
+    }
+
+    for (long t = 0; t < g_sim_ticks; t++) {
+        // timers run out: thinkers get hungry, eaters put both forks down
+        sim_vec_t woke = zero, fed = zero;
+        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+            sim_vec_t expired = (sim_vec_t)(timer[i] == 0);
+            woke |= expired & think & (1u << i);
+            fed |= expired & eat & (1u << i);
+            timer[i] -= ~expired & 1;
+        }
+        think = (think & ~woke) | fed;
+        hungry |= woke;
+        eat &= ~fed;
+        taken &= ~(fed & hl) & ~sim_rotl(fed & hr);
+        hl &= ~fed;
+        hr &= ~fed;
+
+        // each hungry philosopher reaches for its next fork; when both
+        // neighbors reach for the same free fork, the tick parity decides
+        sim_vec_t want_l = hungry & ~hl & (lf | hr);
+        sim_vec_t want_r = hungry & ~hr & (~lf | hl);
+        sim_vec_t got_l = want_l & ~taken;            // fork i, by i
+        sim_vec_t got_r = sim_rotl(want_r) & ~taken;  // fork i, by i-1
+        sim_vec_t clash = got_l & got_r;
+        if (t & 1) {
+            got_r &= ~clash;
+        } else {
+            got_l &= ~clash;
+        }
+        taken |= got_l | got_r;
+        hl |= got_l;
+        hr |= sim_rotr(got_r);
+
+        // both forks in hand: eat
+        sim_vec_t start = hungry & hl & hr;
+        hungry &= ~start;
+        eat |= start;
+
+        for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+            sim_vec_t now = sim_has(start, i);
+            sim_vec_t fresh = sim_sample(&rng);
+            sim_vec_t thinking_again = sim_has(fed, i);
+            timer[i] = (timer[i] & ~(now | thinking_again)) |
+                       (fresh & (now | thinking_again));
+            for (int k = 0; k < lanes; k++) {
+                if (!now[k]) continue;
+                long long w = wait[i][k];
+                r->hist[w < SIM_HIST ? w : SIM_HIST]++;
+                if (w > r->max_wait) r->max_wait = w;
+            }
+            wait[i] = (wait[i] & ~now) + ((hungry >> i) & 1);
+            meals += (start >> i) & 1;
+            eaters += (eat >> i) & 1;
+        }
+
+        if ((t + 1) % SIM_FLUSH_TICKS == 0 || t + 1 == g_sim_ticks) {
+            for (int k = 0; k < SIM_LANES; k++) {
+                meals_sum[k] += meals[k];
+                eaters_sum[k] += eaters[k];
+            }
+            meals = zero;
+            eaters = zero;
+        }
+    }
+
+    for (int k = 0; k < lanes; k++) {
+        r->meals += meals_sum[k];
+        r->eater_ticks += eaters_sum[k];
+        sim_table_meals[first + k] = meals_sum[k];
+    }
+}
+
+static void *sim_worker(void *vp) {
+    (void)vp;
+    static const sim_result_t empty;
+    sim_result_t *r = malloc(sizeof *r);
+    if (r == NULL) {
+        perror("malloc");
+        exit(1);
+    }
+    *r = empty;
+    for (;;) {
+        long first = atomic_fetch_add(&sim_next_block, SIM_LANES);
+        if (first >= g_sim_tables) break;
+        long lanes = g_sim_tables - first;
+        sim_block(first, lanes < SIM_LANES ? (int)lanes : SIM_LANES, r);
+    }
+
+    pthread_mutex_lock(&sim_mtx);
+    sim_total.meals += r->meals;
+    sim_total.eater_ticks += r->eater_ticks;
+    for (int b = 0; b <= SIM_HIST; b++) sim_total.hist[b] += r->hist[b];
+    if (r->max_wait > sim_total.max_wait) sim_total.max_wait = r->max_wait;
+    pthread_mutex_unlock(&sim_mtx);
+    free(r);
+    return NULL;
+}
+
+// smallest hungry time (ms) covering fraction q of all meals
+static long sim_percentile(double q) {
+    long long total = 0, seen = 0;
+    for (int b = 0; b <= SIM_HIST; b++) total += sim_total.hist[b];
+    for (int b = 0; b <= SIM_HIST; b++) {
+        seen += sim_total.hist[b];
+        if ((double)seen >= q * (double)total) return b;
+    }
+    return SIM_HIST;
+}
+
+// --simulate: batch Monte Carlo over many tables
+static int simulate_main(void) {
+    if (NUM_PHILOSOPHERS < 2 || NUM_PHILOSOPHERS > 32) {
+        fprintf(stderr, "simulate: needs 2..32 philosophers\n");
+        return 1;
+    }
+    long jobs = g_xp_jobs;
+#ifdef _SC_NPROCESSORS_ONLN
+    if (jobs <= 0) jobs = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (jobs <= 0) jobs = 1;
+    if (jobs > 64) jobs = 64;
+
+    sim_table_meals = calloc((size_t)g_sim_tables, sizeof *sim_table_meals);
+    if (sim_table_meals == NULL) {
+        perror("calloc");
+        return 1;
+    }
+
+    long long t0 = now_ns();
+    pthread_t th[64];
+    for (long j = 0; j < jobs; j++) {
+        int rc = pthread_create(&th[j], NULL, sim_worker, NULL);
+        if (rc != 0) die_errno("pthread_create", rc);
+    }
+    for (long j = 0; j < jobs; j++) pthread_join(th[j], NULL);
+    double secs = (double)(now_ns() - t0) / 1e9;
+
+    const double sim_secs = (double)g_sim_ticks / 1000.0;
+    const double table_ticks = (double)g_sim_tables * (double)g_sim_ticks;
+    qsort(sim_table_meals, (size_t)g_sim_tables, sizeof *sim_table_meals, cmp_ll);
+
+    printf("simulate: %ld tables x %d philosophers, %.1f s simulated each, "
+           "dawdle 0..%ld ms, %ld job(s), %d lanes\n", g_sim_tables,
+           NUM_PHILOSOPHERS, sim_secs, g_dawdle_ms, jobs, SIM_LANES);
+    printf("elapsed %.3f s: %.3g table-ticks/s, %.0fx real time in total\n",
+           secs, secs > 0 ? table_ticks / secs : 0.0,
+           secs > 0 ? (double)g_sim_tables * sim_secs / secs : 0.0);
+    printf("throughput: %.3f meals/s per table (min %.3f, median %.3f, "
+           "max %.3f)\n",
+           (double)sim_total.meals / (double)g_sim_tables / sim_secs,
+           (double)sim_table_meals[0] / sim_secs,
+           (double)sim_table_meals[g_sim_tables / 2] / sim_secs,
+           (double)sim_table_meals[g_sim_tables - 1] / sim_secs);
+    printf("concurrency: %.3f eaters on average of %d possible\n",
+           (double)sim_total.eater_ticks / table_ticks, NUM_PHILOSOPHERS / 2);
+    printf("hungry ms: p50 %ld  p90 %ld  p99 %ld  p99.9 %ld  max %lld\n",
+           sim_percentile(0.50), sim_percentile(0.90), sim_percentile(0.99),
+           sim_percentile(0.999), sim_total.max_wait);
+    free(sim_table_meals);
+    return 0;
+}
+
+// ----- analytical model -----
+// --model N builds a continuous-time Markov chain for a ring of N
+// philosophers with exponential think and eat times: each is thinking,
+// hungry or eating, and a hungry philosopher starts eating the moment
+// neither neighbor eats (ties between newly unblocked neighbors split
+// evenly). States equal up to rotation or reflection of the ring are
+// lumped into one, the chain is solved by Gauss-Seidel sweeps over its
+// sparse incoming-rate lists, and the solution predicts meals/s and
+// concurrency. Parity's hold-and-wait is not modeled, so measured runs
+// should come in at or below the prediction. Rings beyond MODEL_MAX_N
+// are extrapolated from the per-seat rate of the largest exact ring.
+#define MODEL_MAX_N 14
+enum { MD_THINK, MD_HUNGRY, MD_EAT };
+
+typedef unsigned long long md_code_t;   // 2 bits per seat
+
+typedef struct {
+    unsigned from, to;
+    double rate;
+}
+md_edge_t;
+
+static long g_model_n;                  // --model N
+static long g_think_ms;                  // --think-ms: mean, default dawdle/2
+static long g_eat_ms;                    // --eat-ms: mean, default dawdle/2
+
+static int md_n;
+static md_code_t *md_codes;             // orbit representatives
+static size_t md_len, md_cap;
+static md_code_t *md_keys;              // code + 1 -> index, open addressing
+static unsigned *md_vals;
+static size_t md_mask;
+static md_edge_t *md_edges;
+static size_t md_nedges, md_edges_cap;
+
+static int md_get(md_code_t c, int i) { return (int)(c >> (2 * i) & 3); }
+static md_code_t md_put(md_code_t c, int i, int v) {
+    return (c & ~(3ULL << (2 * i))) | (md_code_t)v << (2 * i);
+}
+
+// smallest code among all rotations and reflections of the ring
+static md_code_t md_canon(md_code_t c) {
+    md_code_t best = c;
+    for (int r = 0; r < md_n; r++) {
+        md_code_t rot = 0, ref = 0;
+        for (int i = 0; i < md_n; i++) {
+            int v = md_get(c, (i + r) % md_n);
+            rot = md_put(rot, i, v);
+            ref = md_put(ref, md_n - 1 - i, v);
+        }
+        if (rot < best) best = rot;
+        if (ref < best) best = ref;
+    }
+    return best;
+}
+
+static void *md_grow(void *p, size_t *cap, size_t elem) {
+    size_t n = *cap ? 2 * *cap : 1024;
+    void *q = realloc(p, n * elem);
+    if (q == NULL) {
+        perror("realloc");
+        exit(1);
+    }
+    *cap = n;
+    return q;
+}
+
+// index of canonical code c, adding it (and queueing it) when new
+static unsigned md_index(md_code_t c) {
+    if (2 * (md_len + 1) > md_mask + 1) {
+        size_t cap = 2 * (md_mask + 1);
+        md_code_t *keys = calloc(cap, sizeof *keys);
+        unsigned *vals = malloc(cap * sizeof *vals);
+        if (keys == NULL || vals == NULL) {
+            perror("calloc");
+            exit(1);
+        }
+        for (size_t j = 0; j <= md_mask; j++) {
+            if (md_keys[j] == 0) continue;
+            size_t k = (md_keys[j] * 0x9e3779b97f4a7c15ULL) >> 20 & (cap - 1);
+            while (keys[k] != 0) k = (k + 1) & (cap - 1);
+            keys[k] = md_keys[j];
+            vals[k] = md_vals[j];
+        }
+        free(md_keys);
+        free(md_vals);
+        md_keys = keys;
+        md_vals = vals;
+        md_mask = cap - 1;
+    }
+    size_t k = ((c + 1) * 0x9e3779b97f4a7c15ULL) >> 20 & md_mask;
+    while (md_keys[k] != 0) {
+        if (md_keys[k] == c + 1) return md_vals[k];
+        k = (k + 1) & md_mask;
+    }
+    if (md_len == md_cap) md_codes = md_grow(md_codes, &md_cap, sizeof *md_codes);
+    md_keys[k] = c + 1;
+    md_vals[k] = (unsigned)md_len;
+    md_codes[md_len] = c;
+    return (unsigned)md_len++;
+}
+
+static void md_add_edge(unsigned from, unsigned to, double rate) {
+    if (from == to) return;  // stays in its own orbit
+    if (md_nedges == md_edges_cap) {
+        md_edges = md_grow(md_edges, &md_edges_cap, sizeof *md_edges);
+    }
+    md_edges[md_nedges++] = (md_edge_t){ from, to, rate };
+}
+
+// lets every unblocked hungry philosopher start eating, one at a time,
+// then records the resulting tangible state(s)
+static void md_settle(unsigned from, md_code_t c, double rate) {
+    int ready[MODEL_MAX_N], k = 0;
+    for (int i = 0; i < md_n; i++) {
+        if (md_get(c, i) != MD_HUNGRY) continue;
+        if (md_get(c, (i + 1) % md_n) == MD_EAT) continue;
+        if (md_get(c, (i + md_n - 1) % md_n) == MD_EAT) continue;
+        ready[k++] = i;
+    }
+    if (k == 0) {
+        md_add_edge(from, md_index(md_canon(c)), rate);
+        return;
+    }
+    for (int j = 0; j < k; j++) {
+        md_settle(from, md_put(c, ready[j], MD_EAT), rate / k);
+    }
+}
+
+static int md_eaters(md_code_t c) {
+    int e = 0;
+    for (int i = 0; i < md_n; i++) e += md_get(c, i) == MD_EAT;
+    return e;
+}
+
+static int cmp_edge_to(const void *a, const void *b) {
+    const md_edge_t *x = a, *y = b;
+    return (x->to > y->to) - (x->to < y->to);
+}
+
+typedef struct {
+    size_t states;
+    int sweeps;
+    double eaters;          // expected simultaneous eaters
+}
+md_solution_t;
+
+static md_solution_t md_solve(int n, double lambda, double mu) {
+    md_solution_t sol = { 0, 0, 0.0 };
+    md_n = n;
+    md_len = md_nedges = 0;
+    free(md_keys);
+    free(md_vals);
+    md_mask = 1023;
+    md_keys = calloc(md_mask + 1, sizeof *md_keys);
+    md_vals = malloc((md_mask + 1) * sizeof *md_vals);
+    if (md_keys == NULL || md_vals == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+
+    // breadth-first over orbits reachable from everyone thinking
+    md_index(0);
+    for (size_t s = 0; s < md_len; s++) {
+        md_code_t c = md_codes[s];
+        for (int i = 0; i < n; i++) {
+            switch (md_get(c, i)) {
+            case MD_THINK:
+                md_settle((unsigned)s, md_put(c, i, MD_HUNGRY), lambda);
+                break;
+            case MD_EAT:
+                md_settle((unsigned)s, md_put(c, i, MD_THINK), mu);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    double *out = calloc(md_len, sizeof *out);
+    double *pi = malloc(md_len * sizeof *pi);
+    size_t *first = calloc(md_len + 1, sizeof *first);
+    if (out == NULL || pi == NULL || first == NULL) {
+        perror("calloc");
+        exit(1);
+    }
+    for (size_t e = 0; e < md_nedges; e++) out[md_edges[e].from] += md_edges[e].rate;
+    qsort(md_edges, md_nedges, sizeof *md_edges, cmp_edge_to);
+    for (size_t e = 0; e < md_nedges; e++) first[md_edges[e].to + 1]++;
+    for (size_t s = 0; s < md_len; s++) first[s + 1] += first[s];
+    for (size_t s = 0; s < md_len; s++) pi[s] = 1.0 / (double)md_len;
+
+    // Gauss-Seidel on the balance equations pi_j * out_j = sum_i pi_i q_ij
+    for (sol.sweeps = 1; sol.sweeps <= 100000; sol.sweeps++) {
+        double delta = 0.0, total = 0.0;
+        for (size_t j = 0; j < md_len; j++) {
+            double in = 0.0;
+            for (size_t e = first[j]; e < first[j + 1]; e++) {
+                in += pi[md_edges[e].from] * md_edges[e].rate;
+            }
+            double next = out[j] > 0 ? in / out[j] : pi[j];
+            double d = fabs(next - pi[j]) / (next > 1e-300 ? next : 1e-300);
+            if (d > delta) delta = d;
+            pi[j] = next;
+            total += next;
+        }
+        for (size_t j = 0; j < md_len; j++) pi[j] /= total;
+        if (delta < 1e-12) break;
+    }
+
+    for (size_t s = 0; s < md_len; s++) sol.eaters += pi[s] * md_eaters(md_codes[s]);
+    sol.states = md_len;
+    free(out);
+    free(pi);
+    free(first);
+    return sol;
+}
+
+// --model: predicted throughput and concurrency
+static int model_main(void) {
+    if (g_think_ms <= 0) g_think_ms = g_dawdle_ms / 2 > 0 ? g_dawdle_ms / 2 : 1;
+    if (g_eat_ms <= 0) g_eat_ms = g_dawdle_ms / 2 > 0 ? g_dawdle_ms / 2 : 1;
+    const double lambda = 1.0 / (double)g_think_ms;   // per ms
+    const double mu = 1.0 / (double)g_eat_ms;
+    int n = g_model_n > MODEL_MAX_N ? MODEL_MAX_N : (int)g_model_n;
+    if (g_model_n > MODEL_MAX_N && (g_model_n - n) % 2 != 0) n--; // keep parity
+
+    long long t0 = now_ns();
+    md_solution_t sol = md_solve(n, lambda, mu);
+    double ms = (double)(now_ns() - t0) / 1e6;
+
+    double per_seat = sol.eaters / n;
+    double eaters = per_seat * (double)g_model_n;
+    printf("model: %ld philosophers, exponential think %ld ms / eat %ld ms "
+           "(means), instant acquisition\n", g_model_n, g_think_ms, g_eat_ms);
+    if (n != g_model_n) {
+        printf("extrapolated from the exact %d-seat ring's per-seat rate\n", n);
+    }
+    printf("chain: %zu lumped states, %zu transitions, %d sweeps, %.2f ms\n",
+           sol.states, md_nedges, sol.sweeps, ms);
+    printf("predicted: %.3f meals/s, %.3f eaters on average of %ld possible "
+           "(%.1f%%)\n", eaters * mu * 1000.0, eaters, g_model_n / 2,
+           100.0 * eaters / (double)(g_model_n / 2));
+    return 0;
+}
+
+// ----- fork pool -----
+// --pool-sweep: a variant table where forks are not placed between
+// philosophers but kept in one pool of K, and every meal takes any two.
+// Free forks are counted in per-CPU shards with a central overflow
+// counter: a release goes to the releasing CPU's shard (spilling past
+// POOL_SHARD_CAP into the center), a grab tries the local shard, then
+// the center, then sweeps every shard into the center. Both forks are
+// taken in one step, so nobody ever holds one fork and waits for the
+// other, and the pool can't deadlock however small K is.
+#define POOL_MAX_N 256
+#define POOL_SHARDS 16
+#define POOL_SHARD_CAP 4
+
+typedef struct {
+    _Alignas(64) atomic_int free;
+}
+pool_shard_t;
+
+typedef struct {
+    int id;
+    long meals;
+    pthread_t tid;
+}
+pool_phil_t;
+
+static pool_shard_t pool_shards[POOL_SHARDS];
+static _Alignas(64) atomic_int pool_central;
+static atomic_int pool_waiters;
+static pthread_mutex_t pool_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_cv = PTHREAD_COND_INITIALIZER;
+static long g_pool_shards = POOL_SHARDS;   // --pool-shards: 1 = central only
+static atomic_int pool_stop;
+
+static pool_shard_t *pool_my_shard(int id) {
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if (cpu >= 0) return &pool_shards[cpu % g_pool_shards];
+#endif
+    return &pool_shards[id % g_pool_shards];
+}
+
+// takes two from *c if it has them
+static int pool_take2(atomic_int *c) {
+    int v = atomic_load_explicit(c, memory_order_relaxed);
+    while (v >= 2) {
+        if (atomic_compare_exchange_weak(c, &v, v - 2)) return 1;
+    }
+    return 0;
+}
+
+// moves every shard's forks into the center
+static void pool_sweep(void) {
+    for (int i = 0; i < g_pool_shards; i++) {
+        int v = atomic_exchange(&pool_shards[i].free, 0);
+        if (v) atomic_fetch_add(&pool_central, v);
+    }
+}
+
+static int pool_try(pool_shard_t *mine) {
+    if (g_pool_shards > 1 && pool_take2(&mine->free)) return 1;
+    if (pool_take2(&pool_central)) return 1;
+    if (g_pool_shards == 1) return 0;
+    pool_sweep();
+    return pool_take2(&pool_central);
+}
+
+// takes two forks; 0 when pool_stop ended the wait first
+static int pool_acquire(int id) {
+    pool_shard_t *mine = pool_my_shard(id);
+    if (pool_try(mine)) return 1;
+    pthread_mutex_lock(&pool_mtx);
+    atomic_fetch_add(&pool_waiters, 1);
+    // checked again under the mutex: a release that missed us broadcasts
+    // under the same mutex, so the wakeup can't be lost
+    int got;
+    while (!(got = pool_try(mine)) && !atomic_load(&pool_stop)) {
+        pthread_cond_wait(&pool_cv, &pool_mtx);
+    }
+    atomic_fetch_sub(&pool_waiters, 1);
+    pthread_mutex_unlock(&pool_mtx);
+    return got;
+}
+
+static void pool_release(int id) {
+    if (atomic_load(&pool_waiters) > 0 || g_pool_shards == 1) {
+        atomic_fetch_add(&pool_central, 2);
+    } else {
+        pool_shard_t *mine = pool_my_shard(id);
+        int v = atomic_fetch_add(&mine->free, 2) + 2;
+        if (v > POOL_SHARD_CAP) {
+            // spill the excess so idle shards don't hoard forks
+            int spill = v - POOL_SHARD_CAP;
+            if (atomic_compare_exchange_strong(&mine->free, &v, POOL_SHARD_CAP)) {
+                atomic_fetch_add(&pool_central, spill);
+            }
+        }
+    }
+    if (atomic_load(&pool_waiters) > 0) {
+        pthread_mutex_lock(&pool_mtx);
+        pthread_cond_broadcast(&pool_cv);
+        pthread_mutex_unlock(&pool_mtx);
+    }
+}
+
+static void *pool_philosopher(void *vp) {
+    pool_phil_t *p = (pool_phil_t *)vp;
+    while (!atomic_load_explicit(&pool_stop, memory_order_relaxed)) {
+        if (!pool_acquire(p->id)) break;
+        if (atomic_load(&pool_stop)) {
+            pool_release(p->id);
+            break;
+        }
+        p->meals++;
+        sleep_ms(random() % (g_dawdle_ms + 1));
+        pool_release(p->id);
+        sleep_ms(random() % (g_dawdle_ms + 1));
+    }
+    return NULL;
+}
+
+// meals per second for n philosophers sharing k forks over ms
+static double pool_run(int n, int k, long ms) {
+    static pool_phil_t phil[POOL_MAX_N];
+    for (int i = 0; i < POOL_SHARDS; i++) atomic_store(&pool_shards[i].free, 0);
+    atomic_store(&pool_central, k);
+    atomic_store(&pool_waiters, 0);
+    atomic_store(&pool_stop, 0);
+    long long t0 = now_ns();
+    for (int i = 0; i < n; i++) {
+        phil[i].id = i;
+        phil[i].meals = 0;
+        int rc = pthread_create(&phil[i].tid, NULL, pool_philosopher, &phil[i]);
+        if (rc != 0) die_errno("pthread_create", rc);
+    }
+    sleep_ms(ms);
+    atomic_store(&pool_stop, 1);
+    pthread_mutex_lock(&pool_mtx);
+    pthread_cond_broadcast(&pool_cv);
+    pthread_mutex_unlock(&pool_mtx);
+    long meals = 0;
+    for (int i = 0; i < n; i++) {
+        pthread_join(phil[i].tid, NULL);
+        meals += phil[i].meals;
+    }
+    return (double)meals / ((double)(now_ns() - t0) / 1e9);
+}
+
+static int g_pool_sweep;
+
+static int pool_sweep_main(void) {
+    static const int ns[] = { 4, 8, 16, 32, 64 };
+    const long ms = g_duration_ms > 0 ? g_duration_ms : 200;
+    printf("fork pool: %ld shard%s, dawdle 0..%ld ms, %ld ms per point; "
+           "meals/s by pool size K\n", g_pool_shards,
+           g_pool_shards == 1 ? "" : "s", g_dawdle_ms, ms);
+    printf("   N       K=2      K=N/4      K=N/2        K=N      no-wait\n");
+    for (size_t i = 0; i < sizeof ns / sizeof ns[0]; i++) {
+        const int n = ns[i];
+        const int ks[] = { 2, n / 4 > 2 ? n / 4 : 2, n / 2, n };
+        printf("  %2d", n);
+        for (int j = 0; j < 4; j++) {
+            printf(" %10.1f", pool_run(n, ks[j], ms));
+            fflush(stdout);
+        }
+        // ceiling if nobody ever waited: one meal per mean eat + think
+        double cycle_ms = g_dawdle_ms > 0 ? (double)g_dawdle_ms : 0.1;
+        printf(" %12.1f\n", 1000.0 * n / cycle_ms);
+    }
+    return 0;
+}
+
+// ----- autotuner -----
+// --autotune FILE races candidate tunings in short timed runs of the real
+// table (successive halving: each round doubles the run time and drops
+// the slower half) and writes the winner as a --config file
+static const char *g_autotune_path;
+
+static void tune_write(FILE *fp, const tune_t *t) {
+    fprintf(fp, "strategy=%s\nbackend=%s\nspin=%d\nbackoff=%d\npin=%s\n",
+            strategies[t->strategy].name, backend_names[t->backend],
+            t->spin_limit, t->backoff_max, pin_names[t->pin]);
+}
+
+static void tune_describe(const tune_t *t, char *buf, size_t len) {
+    if (t->backend == FORK_SPIN) {
+        snprintf(buf, len, "%s/spin %d, backoff %d/pin %s",
+                 strategies[t->strategy].name, t->spin_limit, t->backoff_max,
+                 pin_names[t->pin]);
+    } else {
+        snprintf(buf, len, "%s/%s/pin %s", strategies[t->strategy].name,
+                 backend_names[t->backend], pin_names[t->pin]);
+    }
+}
+
+// applies one key=value setting; returns 0 on success
+static int tune_set(tune_t *t, const char *key, const char *val) {
+    long num;
+    int k;
+    if (strcmp(key, "strategy") == 0) {
+        for (k = 0; k < NUM_STRATEGIES; k++) {
+            if (strcmp(strategies[k].name, val) == 0) break;
+        }
+        if (k == NUM_STRATEGIES) return -1;
+        t->strategy = k;
+    } else if (strcmp(key, "backend") == 0) {
+        if ((k = name_index(backend_names, NUM_BACKENDS, val)) < 0) return -1;
+        t->backend = k;
+    } else if (strcmp(key, "pin") == 0) {
+        if ((k = name_index(pin_names, 2, val)) < 0) return -1;
+        t->pin = k;
+    } else if (strcmp(key, "spin") == 0) {
+        if (parse_num(val, 0, INT_MAX, &num) != 0) return -1;
+        t->spin_limit = (int)num;
+    } else if (strcmp(key, "backoff") == 0) {
+        if (parse_num(val, 1, 1 << 20, &num) != 0) return -1;
+        t->backoff_max = (int)num;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// reads a file of key=value lines written by --autotune
+static int tune_load(const char *path, tune_t *t) {
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+    char line[128];
+    int rc = 0;
+    while (rc == 0 && fgets(line, sizeof line, fp) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '#' || line[0] == '\0') continue;
+        char *eq = strchr(line, '=');
+        if (eq == NULL) {
+            rc = -1;
+        } else {
+            *eq = '\0';
+            rc = tune_set(t, line, eq + 1);
+        }
+        if (rc != 0) fprintf(stderr, "%s: bad setting: %s\n", path, line);
+    }
+    fclose(fp);
+    return rc;
+}
+
+// runs the table for ms milliseconds under t; returns meals per second
+static double run_timed(const tune_t *t, long ms) {
+    g_tune = *t;
+    table_reset(INT_MAX, 1);
+    forks_init_all();
+    long long t0 = now_ns();
+    table_start();
+    sleep_ms(ms);
+    atomic_store(&g_stop, 1);
+    table_join();
+    double secs = (double)(now_ns() - t0) / 1e9;
+    forks_destroy_all();
+    return (double)meals_total() / secs;
+}
+
+typedef struct {
+    tune_t tune;
+    double score;   // meals/s in the latest round
+}
+tune_cand_t;
+
+static int cmp_cand(const void *a, const void *b) {
+    double x = ((const tune_cand_t *)a)->score, y = ((const tune_cand_t *)b)->score;
+    return (x < y) - (x > y);
+}
+
+static int autotune_main(void) {
+    static const int spins[] = { 10, 100, 1000 };
+    static const int backoffs[] = { 1, 16, 256 };
+    tune_cand_t cand[128];
+    int n = 0;
+#ifdef __linux__
+    const int npin = 2;
+#else
+    const int npin = 1;   // no affinity API to tune
+#endif
+    for (int st = 0; st < NUM_STRATEGIES; st++) {
+        for (int pin = 0; pin < npin; pin++) {
+            cand[n++].tune = (tune_t){ st, FORK_HANDOFF, 0, 1, pin };
+            if (g_max_hungry_ms) continue;  // only handoff honours it
+            cand[n++].tune = (tune_t){ st, FORK_SEM, 0, 1, pin };
+            cand[n++].tune = (tune_t){ st, FORK_TICKET, 0, 1, pin };
+            cand[n++].tune = (tune_t){ st, FORK_BIASED, 0, 1, pin };
+            for (int a = 0; a < 3; a++) {
+                for (int b = 0; b < 3; b++) {
+                    cand[n++].tune = (tune_t){ st, FORK_SPIN, spins[a],
+                                               backoffs[b], pin };
+                }
+            }
+        }
+    }
+
+    long budget = g_duration_ms > 0 ? g_duration_ms : 20;
+    g_quiet = 1;
+    printf("autotune: %d candidates, %d philosophers, dawdle 0..%ld ms, "
+           "first round %ld ms each\n", n, NUM_PHILOSOPHERS, g_dawdle_ms, budget);
+    char desc[96];
+    for (int round = 1; n > 1; round++, budget *= 2) {
+        for (int k = 0; k < n; k++) {
+            cand[k].score = run_timed(&cand[k].tune, budget);
+        }
+        qsort(cand, (size_t)n, sizeof cand[0], cmp_cand);
+        tune_describe(&cand[0].tune, desc, sizeof desc);
+        printf("  round %d: %3d x %5ld ms, best %10.0f meals/s (%s), worst %.0f\n",
+               round, n, budget, cand[0].score, desc, cand[n - 1].score);
+        fflush(stdout);
+        n = (n + 1) / 2;
+    }
+
+    tune_describe(&cand[0].tune, desc, sizeof desc);
+    printf("best: %s, %.0f meals/s\n", desc, cand[0].score);
+    FILE *fp = fopen(g_autotune_path, "w");
+    if (fp == NULL) {
+        perror(g_autotune_path);
+        return 1;
+    }
+    fprintf(fp, "# dine --autotune, %d philosophers, dawdle 0..%ld ms\n",
+            NUM_PHILOSOPHERS, g_dawdle_ms);
+    tune_write(fp, &cand[0].tune);
+    if (fclose(fp) == EOF) {
+        perror(g_autotune_path);
+        return 1;
+    }
+    printf("written to %s; load it with --config %s\n", g_autotune_path,
+           g_autotune_path);
+    return 0;
+}
+
+// ----- benchmarks -----
+// --bench: micro-benchmarks of the table's own bookkeeping
+static int g_bench;
+
+enum { CNT_SHARED, CNT_PERCPU, CNT_PERTHREAD };
+
+typedef struct {
+    int id, mode;
+    long iters;
+    long local;         // CNT_PERTHREAD's counter
+    pthread_t tid;
+}
+bench_thread_t;
+
+static atomic_long bench_shared;
+static atomic_int bench_go;
+
+static void *bench_counter_thread(void *vp) {
+    bench_thread_t *b = (bench_thread_t *)vp;
+    while (!atomic_load(&bench_go)) sched_yield();
+    for (long i = 0; i < b->iters; i++) {
+        switch (b->mode) {
+            case CNT_SHARED:
+                atomic_fetch_add_explicit(&bench_shared, 1, memory_order_relaxed);
+                break;
+            case CNT_PERCPU:
+                meals_add(b->id);
+                break;
+            default:
+                b->local++;
+                __asm__ __volatile__("" : : "r"(b->local) : "memory");
+                break;
+        }
+    }
+    return NULL;
+}
+
+// ns per increment, as total thread time / total increments
+static double bench_counter(int mode, int threads, long iters) {
+    static bench_thread_t th[256];
+    atomic_store(&bench_shared, 0);
+    atomic_store(&bench_go, 0);
+    meals_reset();
+    for (int i = 0; i < threads; i++) {
+        th[i] = (bench_thread_t){ i, mode, iters, 0, 0 };
+        int rc = pthread_create(&th[i].tid, NULL, bench_counter_thread, &th[i]);
+        if (rc != 0) die_errno("pthread_create", rc);
+    }
+    long long t0 = now_ns();
+    atomic_store(&bench_go, 1);
+    long total = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(th[i].tid, NULL);
+        total += th[i].local;
+    }
+    long long ns = now_ns() - t0;
+    total += atomic_load(&bench_shared) + meals_total();
+    if (total != (long)threads * iters) {
+        fprintf(stderr, "bench: lost increments (%ld of %ld)\n", total,
+                (long)threads * iters);
+        exit(1);
+    }
+    // threads beyond the CPU count only time-share, so charge wall time
+    // per CPU actually available
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    if (cpus > threads) cpus = threads;
+    return (double)ns * (double)cpus / (double)total;
+}
+
+// ns per call of a clock, best of a few rounds
+static double bench_clock(long long (*clock)(void)) {
+    const long calls = 1000000;
+    double best = 1e9;
+    for (int round = 0; round < 5; round++) {
+        long long sink = 0, t0 = os_clock_ns();
+        for (long i = 0; i < calls; i++) sink += clock();
+        double ns = (double)(os_clock_ns() - t0) / (double)calls;
+        __asm__ __volatile__("" : : "r"(sink));
+        if (ns < best) best = ns;
+    }
+    return best;
+}
+
+// the bare counter read, unscaled
+static long long tsc_clock_raw(void) {
+    return (long long)tsc_read();
+}
+
+static int bench_main(void) {
+    static const int threads[] = { 1, 4, 64, 128 };
+    printf("timer: %s, now_ns %.1f ns per call; vDSO clock_gettime %.1f ns",
+           g_tsc ? "invariant TSC" : "OS clock", bench_clock(now_ns),
+           bench_clock(os_clock_ns));
+    if (g_tsc) printf(", bare rdtsc %.1f ns", bench_clock(tsc_clock_raw));
+    printf("\n");
+
+    // a tracepoint with tracing off
+    const long calls = 10000000;
+    long long t0 = now_ns();
+    for (long i = 0; i < calls; i++) TRACE(TRACE_STATE, 0, (int)g_state[0]);
+    printf("tracepoint (off): %.2f ns\n\n",
+           (double)(now_ns() - t0) / (double)calls);
+
+    static const char *const names[] = { "shared atomic", "per-CPU", "per-thread" };
+    const long iters = 1000000;
+    printf("meal counter: ns per increment (%ld per thread, %ld CPUs, rseq %s)\n",
+           iters, sysconf(_SC_NPROCESSORS_ONLN), rseq_cpu() >= 0 ? "on" : "off");
+    printf("  threads");
+    for (int m = 0; m < 3; m++) printf(" %14s", names[m]);
+    printf("\n");
+    double percpu = 0.0;
+    for (size_t i = 0; i < sizeof threads / sizeof threads[0]; i++) {
+        printf("  %7d", threads[i]);
+        for (int m = 0; m < 3; m++) {
+            double ns = bench_counter(m, threads[i], iters);
+            if (m == CNT_PERCPU && ns > percpu) percpu = ns;
+            printf(" %14.2f", ns);
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+
+    // against the cheapest meal the table can serve
+    g_quiet = 1;
+    g_dawdle_ms = 0;
+    double meal_ns = 1e9 / run_timed(&g_tune, 300);
+    printf("table meal at dawdle 0: %.0f ns; per-CPU count adds at most "
+           "%.3f%%\n", meal_ns, 100.0 * percpu / meal_ns);
+    return 0;
+}
+
+// ----- batch sweep -----
+static int g_batch_sweep;           // --batch-sweep: throughput vs latency
+
+// runs the table for each batch size K and reports the meals gained
+// against what the neighbors pay in hungry time
+static int batch_sweep_main(void) {
+    static const long ks[] = { 1, 2, 4, 8, 16 };
+    const long ms = g_duration_ms > 0 ? g_duration_ms : 500;
+    g_quiet = 1;
+    g_latency = 1;
+    printf("batch sweep: %d philosophers, dawdle 0..%ld ms, batch-ms %ld, "
+           "%ld ms per point\n", NUM_PHILOSOPHERS, g_dawdle_ms, g_batch_ms, ms);
+    printf("   K     meals/s    gain   hungry mean      p99      max\n");
+    double base = 0.0;
+    for (size_t i = 0; i < sizeof ks / sizeof ks[0]; i++) {
+        g_batch = ks[i];
+        double rate = run_timed(&g_tune, ms);
+        if (i == 0) base = rate;
+        lat_summary_t s = lat_summarize();
+        printf("  %2ld  %10.1f  %5.2fx   %8.3f ms  %7.3f  %7.3f\n", ks[i],
+               rate, base > 0 ? rate / base : 0.0, s.mean_ms, s.p99_ms,
+               s.max_ms);
+        fflush(stdout);
+    }
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [options] [positive cycles]\n"
+        "  --stats, --heatmap FILE       summary after the run\n"
+        "  --quiet                       do not print the table\n"
+        "  --duration MS                 run for MS instead of a cycle count\n"
+        "  --dawdle MS                   max think/eat time (default %d)\n"
+        "  --strategy parity|ordered|waiter,\n"
+        "  --backend sem|spin|handoff|ticket|biased,\n"
+        "  --spin N, --backoff N, --pin none|compact, --config FILE\n"
+        "  --autotune FILE               search tunings, write the best\n"
+        "  --adaptive [--adapt-high %%] [--adapt-low %%] [--adapt-wait MS]\n"
+        "                                switch parity/waiter on contention\n"
+        "  --batch K [--batch-ms MS]     eat up to K meals per fork grab\n"
+        "  --batch-sweep                 throughput and hungry time over K\n"
+        "  --max-hungry MS               age hungry philosophers, bound waits\n"
+        "                                (with --backend handoff)\n"
+        "  --preempt MS                  end meals early for a waiting neighbor\n"
+        "  --table FILE                  per-philosopher times, cycles, priority\n"
+        "  --pool-sweep [--pool-shards S] N philosophers sharing K forks\n"
+        "  --bench                       cost of the table's bookkeeping\n"
+        "  --no-tsc                      time with the OS clock, not the TSC\n"
+        "  --trace FILE [--trace-ctl FILE] [--trace-events N]\n"
+        "               [--trace-keyframe K]\n"
+        "                                fork/state events; SIGUSR1 toggles\n"
+        "                                (to " TRACE_DEFAULT_PATH " without --trace)\n"
+        "  --seek FILE [--at N | --at-ns NS]  table at a point of a trace\n"
+        "  --render FILE [--jobs N]      print a trace as the table's rows\n"
+        "  --record FILE | --replay FILE\n"
+        "  --explore random|dfs [--runs N] [--jobs N] [--bound K]\n"
+        "  --check N [--jobs N] [--check-slots LOG2]\n"
+        "  --simulate TABLES [--ticks MS] [--jobs N]\n"
+        "  --model N [--think-ms MS] [--eat-ms MS]\n",
+        prog, DAWDLEFACTOR);
+}
+
+// ----- main -----
+
+// runs a mode that drives the table with the trace signals installed
+static int traced_main(int (*mode)(void)) {
+    g_run_start = now_ns();
+    trace_start();
+    int rc = mode();
+    trace_finish();
+    return rc;
+}
+
+int main(int argc, char **argv) {
+    struct timeval tv;
+    if (gettimeofday(&tv, NULL) == -1) {
+        perror("gettimeofday");
+        return 1;
+    }
+    srandom((unsigned)(tv.tv_sec ^ tv.tv_usec));
+
+    // parse options and the optional cycles argument
+    profiles_init();
+    long cycles = 1;
+    int have_cycles = 0, have_dawdle = 0, no_tsc = 0;
+    long seek_ns;
+    for (int i = 1; i < argc; i++) {
+        const char *opt = argv[i];
+        const char *val = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(opt, "--stats") == 0) {
+            g_stats = 1;
+            continue;
+        }
+        if (strcmp(opt, "--quiet") == 0) {
+            g_quiet = 1;
+            continue;
+        }
+        if (strcmp(opt, "--duration") == 0 && val != NULL &&
+            parse_num(argv[++i], 1, LONG_MAX / 1000000, &g_duration_ms) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--dawdle") == 0 && val != NULL &&
+            parse_num(argv[++i], 0, INT_MAX / 2, &g_dawdle_ms) == 0) {
+            have_dawdle = 1;
+            continue;
+        }
+        if ((strcmp(opt, "--strategy") == 0 || strcmp(opt, "--backend") == 0 ||
+             strcmp(opt, "--spin") == 0 || strcmp(opt, "--backoff") == 0 ||
+             strcmp(opt, "--pin") == 0) && val != NULL &&
+            tune_set(&g_tune, opt + 2, argv[++i]) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--adaptive") == 0) {
+            g_adaptive = 1;
+            continue;
+        }
+        if (strcmp(opt, "--adapt-high") == 0 && val != NULL &&
+            parse_num(argv[++i], 0, 100, &g_adapt_high) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--adapt-low") == 0 && val != NULL &&
+            parse_num(argv[++i], 0, 100, &g_adapt_low) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--adapt-wait") == 0 && val != NULL &&
+            parse_num(argv[++i], 1, INT_MAX, &g_adapt_wait_ms) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--batch") == 0 && val != NULL &&
+            parse_num(argv[++i], 1, INT_MAX, &g_batch) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--batch-ms") == 0 && val != NULL &&
+            parse_num(argv[++i], 0, INT_MAX / 2, &g_batch_ms) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--batch-sweep") == 0) {
+            g_batch_sweep = 1;
+            continue;
+        }
+        if (strcmp(opt, "--preempt") == 0 && val != NULL &&
+            parse_num(argv[++i], 1, INT_MAX / 2, &g_preempt_ms) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--max-hungry") == 0 && val != NULL &&
+            parse_num(argv[++i], 1, INT_MAX / 2, &g_max_hungry_ms) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--table") == 0 && val != NULL) {
+            if (profiles_load(argv[++i]) != 0) return 1;
+            continue;
+        }
+        if (strcmp(opt, "--trace") == 0 && val != NULL) {
+            g_trace_path = argv[++i];
+            continue;
+        }
+        if (strcmp(opt, "--trace-ctl") == 0 && val != NULL) {
+            g_trace_ctl = argv[++i];
+            continue;
+        }
+        if (strcmp(opt, "--trace-events") == 0 && val != NULL &&
+            parse_num(argv[++i], 1, LONG_MAX / 64, &g_trace_cap) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--trace-keyframe") == 0 && val != NULL &&
+            parse_num(argv[++i], 1, INT_MAX, &g_trace_every) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--render") == 0 && val != NULL) {
+            g_render_path = argv[++i];
+            continue;
+        }
+        if (strcmp(opt, "--seek") == 0 && val != NULL) {
+            g_seek_path = argv[++i];
+            continue;
+        }
+        if (strcmp(opt, "--at") == 0 && val != NULL &&
+            parse_num(argv[++i], 0, LONG_MAX, &g_seek_event) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--at-ns") == 0 && val != NULL &&
+            parse_num(argv[++i], 0, LONG_MAX, &seek_ns) == 0) {
+            g_seek_ns = seek_ns;
+            continue;
+        }
+        if (strcmp(opt, "--no-tsc") == 0) {
+            no_tsc = 1;
+            continue;
+        }
+        if (strcmp(opt, "--bench") == 0) {
+            g_bench = 1;
+            continue;
+        }
+        if (strcmp(opt, "--pool-sweep") == 0) {
+            g_pool_sweep = 1;
+            continue;
+        }
+        if (strcmp(opt, "--pool-shards") == 0 && val != NULL &&
+            parse_num(argv[++i], 1, POOL_SHARDS, &g_pool_shards) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--config") == 0 && val != NULL) {
+            if (tune_load(argv[++i], &g_tune) != 0) return 1;
+            continue;
+        }
+        if (strcmp(opt, "--autotune") == 0 && val != NULL) {
+            g_autotune_path = argv[++i];
+            continue;
+        }
+        if (strcmp(opt, "--record") == 0 && val != NULL) {
+            g_record_path = argv[++i];
+            continue;
+        }
+        if (strcmp(opt, "--replay") == 0 && val != NULL) {
+            g_replay_path = argv[++i];
+            continue;
+        }
+        if (strcmp(opt, "--heatmap") == 0 && val != NULL) {
+            g_heatmap_path = argv[++i];
+            g_stats = 1;
+            continue;
+        }
+        if (strcmp(opt, "--explore") == 0 && val != NULL &&
+            (strcmp(val, "random") == 0 || strcmp(val, "dfs") == 0)) {
+            g_explore = strcmp(argv[++i], "dfs") == 0 ? XP_DFS : XP_RANDOM;
+            continue;
+        }
+        if (strcmp(opt, "--runs") == 0 && val != NULL &&
+            parse_num(argv[++i], 1, LONG_MAX, &g_xp_runs) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--jobs") == 0 && val != NULL &&
+            parse_num(argv[++i], 1, 64, &g_xp_jobs) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--bound") == 0 && val != NULL &&
+            parse_num(argv[++i], 1, INT_MAX, &g_xp_bound) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--check") == 0 && val != NULL &&
+            parse_num(argv[++i], 2, MC_MAX_N, &g_mc_n) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--check-slots") == 0 && val != NULL &&
+            parse_num(argv[++i], 10, 31, &g_mc_log2) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--simulate") == 0 && val != NULL &&
+            parse_num(argv[++i], 1, LONG_MAX / SIM_LANES, &g_sim_tables) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--ticks") == 0 && val != NULL &&
+            parse_num(argv[++i], 1, LONG_MAX, &g_sim_ticks) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--model") == 0 && val != NULL &&
+            parse_num(argv[++i], 2, INT_MAX, &g_model_n) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--think-ms") == 0 && val != NULL &&
+            parse_num(argv[++i], 1, INT_MAX, &g_think_ms) == 0) {
+            continue;
+        }
+        if (strcmp(opt, "--eat-ms") == 0 && val != NULL &&
+            parse_num(argv[++i], 1, INT_MAX, &g_eat_ms) == 0) {
+            continue;
+        }
+        if (have_cycles || parse_num(opt, 1, INT_MAX, &cycles) != 0) {
+            usage(argv[0]);
+            return 1;
+        }
+        have_cycles = 1;
+    }
+    clock_init(!no_tsc);
+    if (g_record_path != NULL && g_replay_path != NULL) {
+        fprintf(stderr, "%s: --record and --replay are exclusive\n", argv[0]);
+        return 1;
+    }
+    if (g_replay_path != NULL &&
+        (g_tune.strategy == STRAT_WAITER || g_adaptive)) {
+        // seats are taken outside the recorded grant order, so a replayed
+        // fork order can deadlock against them
+        fprintf(stderr, "%s: --replay does not support the waiter strategy\n",
+                argv[0]);
+        return 1;
+    }
+    if (g_replay_path != NULL) {
+        // the schedule fixes the cycle counts it was recorded with
+        cycles = sched_load(g_replay_path);
+        if (cycles < 0) return 1;
+    }
+    if (g_record_path != NULL || g_replay_path != NULL || g_explore) {
+        g_batch = 1;  // batching depends on timing, which replay can't fix
+        g_max_hungry_ms = 0;  // so does standing back
+        g_preempt_ms = 0;     // and cutting meals short
+    }
+    if (g_max_hungry_ms && g_tune.backend != FORK_HANDOFF &&
+        g_autotune_path == NULL) {
+        fprintf(stderr, "%s: --max-hungry needs --backend handoff, the only "
+                "one that grants forks by priority\n", argv[0]);
+        return 1;
+    }
+    g_latency = g_stats;
+
+    if (g_explore) {
+        g_adaptive = 0;  // the explorer drives one thread at a time
+        return explore_main(cycles);
+    }
+    if (g_mc_n > 0) {
+        return check_main();
+    }
+    if (g_sim_tables > 0) {
+        return simulate_main();
+    }
+    if (g_model_n > 0) {
+        return model_main();
+    }
+    if (g_seek_path != NULL) {
+        return seek_main();
+    }
+    if (g_render_path != NULL) {
+        return render_main();
+    }
+    if (g_autotune_path != NULL) {
+        if (!have_dawdle) g_dawdle_ms = 1;  // tune the locking, not the sleeps
+        return traced_main(autotune_main);
+    }
+    if (g_batch_sweep) {
+        return traced_main(batch_sweep_main);
+    }
+    if (g_bench) {
+        return traced_main(bench_main);
+    }
+    if (g_pool_sweep) {
+        if (!have_dawdle) g_dawdle_ms = 1;
+        return traced_main(pool_sweep_main);
+    }
+
+    // init shared state
+    table_reset(g_duration_ms > 0 ? INT_MAX : cycles, g_duration_ms > 0);
+    for (int i = 0; i < NUM_PHILOSOPHERS; i++) {
+        // the schedule fixes each philosopher's count, whatever --table says
+        if (g_replay_path != NULL) args[i].cycles = (int)g_sched_cycles[i];
+        if (g_record_path != NULL) g_sched_cycles[i] = args[i].cycles;
+    }
+
+    // init semaphores (forks)
+    forks_init_all();
+
+    print_header();
+
+    g_run_start = now_ns();
+    g_eaters_since = g_run_start;
+    trace_start();
+
+    table_start();
+    if (g_duration_ms > 0) {
+        sleep_ms(g_duration_ms);
+        atomic_store(&g_stop, 1);
+    }
+    table_join();
+
+    // bottom border
+    pthread_mutex_lock(&print_mtx);
+    g_run_end = now_ns();
+    eaters_change_locked(0);
+    if (!g_quiet) {
+        printf("|");
+        for (int i = 0; i < NUM_PHILOSOPHERS; i++) printf("=============|");
+        printf("\n");
+    }
     pthread_mutex_unlock(&print_mtx);
 
+    if (g_stats) {
+        double secs = (double)(g_run_end - g_run_start) / 1e9;
+        long meals = meals_total();
+        printf("\nrun time: %.3f s, %ld meals (%.1f/s), %.3f s hungry in all\n",
+               secs, meals, secs > 0 ? (double)meals / secs : 0.0,
+               (double)wait_total() / 1e9);
+        print_concurrency_report();
+        print_fork_report();
+        print_latency_report();
+        print_philosopher_report();
+        if (g_tune.backend == FORK_BIASED) print_bias_report();
+        if (g_max_hungry_ms) print_starvation_report();
+        if (g_preempt_ms) print_preempt_report(meals);
+        print_publish_report();
+        if (g_adaptive) print_adaptive_report();
+    }
+    if (g_heatmap_path != NULL) {
+        write_fork_csv(g_heatmap_path);
+    }
+    if (g_record_path != NULL) {
+        sched_write(g_record_path, cycles);
+    }
+    trace_finish();
+
     forks_destroy_all();
     return 0;
 }
@@ -0,0 +1,441 @@
+// trace.c
+// Seekable trace writer and reader; see trace.h for the layout.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+static const char trace_magic[8] = { 'D', 'I', 'N', 'E', 'T', 'R', 'C', '3' };
+static const char index_magic[8] = { 'D', 'I', 'N', 'E', 'I', 'D', 'X', '1' };
+
+#define TRAILER_SIZE 32     // index offset, keyframe count, event count,
+                            // index_magic
+#define INDEX_ENTRY 24      // file offset, event index, ts
+
+// one keyframe's place in the file
+typedef struct {
+    unsigned long long offset;
+    long index;
+    long long ts;
+}
+trace_key_t;
+
+struct trace_writer {
+    FILE *fp;
+    const char *path;
+    int every;
+    long in_block;          // events since the last keyframe
+    trace_frame_t f;        // the table after the last event
+    trace_key_t *keys;
+    long nkeys, cap;
+};
+
+struct trace_reader {
+    unsigned char *buf;
+    size_t len;
+    int n;
+    long count;
+    trace_key_t *keys;
+    long nkeys;
+    size_t pos;             // next byte to decode
+    long next;              // index of the next event
+    int borrowed;           // buf and keys belong to another reader
+};
+
+// ----- encoding -----
+
+static void put_varint(FILE *fp, unsigned long long v) {
+    while (v >= 0x80) {
+        putc((int)(v & 0x7f) | 0x80, fp);
+        v >>= 7;
+    }
+    putc((int)v, fp);
+}
+
+static void put_u64(FILE *fp, unsigned long long v) {
+    for (int i = 0; i < 8; i++) putc((int)(v >> (8 * i)) & 0xff, fp);
+}
+
+// decodes a varint at *pos; returns -1 past the end of buf
+static int get_varint(const unsigned char *buf, size_t len, size_t *pos,
+                      unsigned long long *out) {
+    unsigned long long v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*pos >= len) return -1;
+        unsigned char b = buf[(*pos)++];
+        v |= (unsigned long long)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *out = v;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static unsigned long long get_u64(const unsigned char *p) {
+    unsigned long long v = 0;
+    for (int i = 0; i < 8; i++) v |= (unsigned long long)p[i] << (8 * i);
+    return v;
+}
+
+// ----- table state -----
+
+void trace_apply(trace_frame_t *f, const trace_event_t *ev) {
+    if (ev->pid < 0 || ev->pid >= f->n) return;
+    if (ev->kind == TRACE_STATE) {
+        f->state[ev->pid] = (unsigned char)ev->arg;
+    } else if (ev->kind == TRACE_GRANT || ev->kind == TRACE_POST) {
+        // which of pid's forks: left is pid itself
+        unsigned char bit = ev->arg == ev->pid ? 1 : 2;
+        if (ev->kind == TRACE_GRANT) {
+            f->hold[ev->pid] |= bit;
+        } else {
+            f->hold[ev->pid] &= (unsigned char)~bit;
+        }
+    }
+    f->index++;
+    f->ts = ev->ts;
+}
+
+// ----- writer -----
+
+// keyframe: 'K' (or 'R' for a sync), event index, ts, then
+// state | hold << 2 per philosopher, two philosophers to a byte
+static int put_keyframe(trace_writer_t *w, int tag) {
+    if (w->nkeys == w->cap) {
+        long cap = w->cap ? 2 * w->cap : 64;
+        trace_key_t *grown = realloc(w->keys, (size_t)cap * sizeof *grown);
+        if (grown == NULL) {
+            perror("realloc");
+            return -1;
+        }
+        w->keys = grown;
+        w->cap = cap;
+    }
+    const trace_frame_t *f = &w->f;
+    w->keys[w->nkeys++] = (trace_key_t){ (unsigned long long)ftell(w->fp),
+                                         f->index, f->ts };
+    putc(tag, w->fp);
+    put_varint(w->fp, (unsigned long long)f->index);
+    put_varint(w->fp, (unsigned long long)f->ts);
+    for (int p = 0; p < f->n; p += 2) {
+        int lo = f->state[p] | f->hold[p] << 2;
+        int hi = p + 1 < f->n ? f->state[p + 1] | f->hold[p + 1] << 2 : 0;
+        putc(lo | hi << 4, w->fp);
+    }
+    w->in_block = 0;
+    return ferror(w->fp) ? -1 : 0;
+}
+
+trace_writer_t *trace_create(const char *path, int n, int keyframe_every) {
+    if (n < 1 || n > TRACE_MAX_N || keyframe_every < 1) {
+        fprintf(stderr, "%s: bad trace parameters\n", path);
+        return NULL;
+    }
+    trace_writer_t *w = calloc(1, sizeof *w);
+    if (w == NULL) {
+        perror("calloc");
+        return NULL;
+    }
+    w->fp = fopen(path, "wb");
+    if (w->fp == NULL) {
+        perror(path);
+        free(w);
+        return NULL;
+    }
+    w->path = path;
+    w->every = keyframe_every;
+    w->f.n = n;
+    fwrite(trace_magic, 1, sizeof trace_magic, w->fp);
+    put_varint(w->fp, (unsigned long long)n);
+    put_varint(w->fp, (unsigned long long)keyframe_every);
+    if (ferror(w->fp)) {
+        perror(path);
+        fclose(w->fp);
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+int trace_append(trace_writer_t *w, const trace_event_t *ev) {
+    if (w->in_block == w->every && put_keyframe(w, 'K') != 0) return -1;
+    trace_event_t e = *ev;
+    if (e.ts < w->f.ts) e.ts = w->f.ts;
+    putc(e.kind, w->fp);
+    put_varint(w->fp, (unsigned long long)(e.ts - w->f.ts));
+    put_varint(w->fp, (unsigned long long)e.pid);
+    put_varint(w->fp, (unsigned long long)e.arg);
+    trace_apply(&w->f, &e);
+    w->in_block++;
+    return 0;
+}
+
+int trace_sync(trace_writer_t *w, const trace_frame_t *f) {
+    if (w->nkeys == 0) {
+        // the first snapshot opens the trace: no event, just keyframe 0
+        int n = w->f.n;
+        w->f = *f;
+        w->f.n = n;
+        w->f.index = 0;
+        return put_keyframe(w, 'K');
+    }
+    long index = w->f.index + 1;        // the sync counts as an event
+    long long ts = f->ts > w->f.ts ? f->ts : w->f.ts;
+    int n = w->f.n;
+    w->f = *f;
+    w->f.n = n;
+    w->f.index = index;
+    w->f.ts = ts;
+    return put_keyframe(w, 'R');
+}
+
+int trace_end(trace_writer_t *w) {
+    FILE *fp = w->fp;
+    unsigned long long index_at = (unsigned long long)ftell(fp);
+    putc('I', fp);
+    for (long j = 0; j < w->nkeys; j++) {
+        put_u64(fp, w->keys[j].offset);
+        put_u64(fp, (unsigned long long)w->keys[j].index);
+        put_u64(fp, (unsigned long long)w->keys[j].ts);
+    }
+    put_u64(fp, index_at);
+    put_u64(fp, (unsigned long long)w->nkeys);
+    put_u64(fp, (unsigned long long)w->f.index);
+    fwrite(index_magic, 1, sizeof index_magic, fp);
+    int rc = 0;
+    if (ferror(fp) || fclose(fp) == EOF) {
+        perror(w->path);
+        rc = -1;
+    }
+    free(w->keys);
+    free(w);
+    return rc;
+}
+
+// ----- reader -----
+
+static void bad_trace(const char *path, trace_reader_t *r) {
+    fprintf(stderr, "%s: not a dine trace (or truncated)\n", path);
+    trace_close(r);
+}
+
+trace_reader_t *trace_open(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        perror(path);
+        return NULL;
+    }
+    trace_reader_t *r = calloc(1, sizeof *r);
+    if (r == NULL || fseek(fp, 0, SEEK_END) != 0) {
+        perror(path);
+        fclose(fp);
+        free(r);
+        return NULL;
+    }
+    long size = ftell(fp);
+    rewind(fp);
+    r->buf = size > 0 ? malloc((size_t)size) : NULL;
+    if (r->buf == NULL || fread(r->buf, 1, (size_t)size, fp) != (size_t)size) {
+        fclose(fp);
+        bad_trace(path, r);
+        return NULL;
+    }
+    fclose(fp);
+    r->len = (size_t)size;
+
+    unsigned long long v;
+    size_t pos = sizeof trace_magic;
+    if (r->len < sizeof trace_magic + TRAILER_SIZE ||
+        memcmp(r->buf, trace_magic, sizeof trace_magic) != 0 ||
+        memcmp(r->buf + r->len - 8, index_magic, sizeof index_magic) != 0 ||
+        get_varint(r->buf, r->len, &pos, &v) != 0 || v < 1 || v > TRACE_MAX_N) {
+        bad_trace(path, r);
+        return NULL;
+    }
+    r->n = (int)v;
+    if (get_varint(r->buf, r->len, &pos, &v) != 0) {        // keyframe_every
+        bad_trace(path, r);
+        return NULL;
+    }
+
+    const unsigned char *trailer = r->buf + r->len - TRAILER_SIZE;
+    unsigned long long index_at = get_u64(trailer);
+    r->nkeys = (long)get_u64(trailer + 8);
+    r->count = (long)get_u64(trailer + 16);
+    unsigned long long index_len = 1 + (unsigned long long)r->nkeys * INDEX_ENTRY;
+    if (r->nkeys < 1 || index_at + index_len != r->len - TRAILER_SIZE) {
+        bad_trace(path, r);
+        return NULL;
+    }
+    r->keys = malloc((size_t)r->nkeys * sizeof *r->keys);
+    if (r->keys == NULL) {
+        perror("malloc");
+        trace_close(r);
+        return NULL;
+    }
+    const unsigned char *e = r->buf + index_at + 1;
+    for (long k = 0; k < r->nkeys; k++, e += INDEX_ENTRY) {
+        r->keys[k].offset = get_u64(e);
+        r->keys[k].index = (long)get_u64(e + 8);
+        r->keys[k].ts = (long long)get_u64(e + 16);
+        if (r->keys[k].offset >= index_at) {
+            bad_trace(path, r);
+            return NULL;
+        }
+    }
+    return r;
+}
+
+trace_reader_t *trace_dup(const trace_reader_t *r) {
+    trace_reader_t *d = malloc(sizeof *d);
+    if (d == NULL) {
+        perror("malloc");
+        return NULL;
+    }
+    *d = *r;
+    d->borrowed = 1;
+    return d;
+}
+
+void trace_close(trace_reader_t *r) {
+    if (r == NULL) return;
+    if (!r->borrowed) {
+        free(r->buf);
+        free(r->keys);
+    }
+    free(r);
+}
+
+int trace_n(const trace_reader_t *r) {
+    return r->n;
+}
+
+long trace_count(const trace_reader_t *r) {
+    return r->count;
+}
+
+long trace_keyframes(const trace_reader_t *r) {
+    return r->nkeys;
+}
+
+long trace_keyframe_event(const trace_reader_t *r, long k) {
+    return k < r->nkeys ? r->keys[k].index : r->count;
+}
+
+// loads the keyframe at pos into *f and points the reader just past it
+static int load_keyframe_at(trace_reader_t *r, size_t pos, trace_frame_t *f) {
+    unsigned long long idx, ts;
+    int tag = r->buf[pos++];
+    if ((tag != 'K' && tag != 'R') ||
+        get_varint(r->buf, r->len, &pos, &idx) != 0 ||
+        get_varint(r->buf, r->len, &pos, &ts) != 0 ||
+        pos + (size_t)(r->n + 1) / 2 > r->len) {
+        return -1;
+    }
+    memset(f, 0, sizeof *f);
+    f->n = r->n;
+    f->index = (long)idx;
+    f->ts = (long long)ts;
+    for (int p = 0; p < r->n; p++) {
+        int nib = (r->buf[pos + p / 2] >> (p % 2 ? 4 : 0)) & 0xf;
+        f->state[p] = (unsigned char)(nib & 3);
+        f->hold[p] = (unsigned char)(nib >> 2);
+    }
+    r->pos = pos + (size_t)(r->n + 1) / 2;
+    r->next = f->index;
+    return 0;
+}
+
+static int load_keyframe(trace_reader_t *r, long k, trace_frame_t *f) {
+    return load_keyframe_at(r, (size_t)r->keys[k].offset, f);
+}
+
+int trace_next(trace_reader_t *r, trace_frame_t *f, trace_event_t *ev) {
+    for (;;) {
+        if (r->next >= r->count || r->pos >= r->len) return 0;
+        int tag = r->buf[r->pos];
+        if (tag == 'I') return 0;
+        if (tag == 'K') {
+            // skip: the running frame already matches it
+            unsigned long long v;
+            r->pos++;
+            if (get_varint(r->buf, r->len, &r->pos, &v) != 0 ||
+                get_varint(r->buf, r->len, &r->pos, &v) != 0) {
+                return 0;
+            }
+            r->pos += (size_t)(r->n + 1) / 2;
+            continue;
+        }
+        if (tag == 'R') {
+            // a sync: the table jumps to the snapshot
+            if (load_keyframe_at(r, r->pos, f) != 0) return 0;
+            *ev = (trace_event_t){ f->ts, TRACE_SYNC, -1, 0 };
+            return 1;
+        }
+        unsigned long long dt, pid, arg;
+        r->pos++;
+        if (get_varint(r->buf, r->len, &r->pos, &dt) != 0 ||
+            get_varint(r->buf, r->len, &r->pos, &pid) != 0 ||
+            get_varint(r->buf, r->len, &r->pos, &arg) != 0) {
+            return 0;
+        }
+        ev->kind = tag;
+        ev->ts = f->ts + (long long)dt;
+        ev->pid = (int)pid;
+        ev->arg = (int)arg;
+        trace_apply(f, ev);
+        r->next++;
+        return 1;
+    }
+}
+
+int trace_seek_event(trace_reader_t *r, long index, trace_frame_t *f) {
+    if (index < 0 || index > r->count) return -1;
+    // last keyframe at or before index
+    long lo = 0, hi = r->nkeys - 1;
+    while (lo < hi) {
+        long mid = (lo + hi + 1) / 2;
+        if (r->keys[mid].index <= index) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    if (load_keyframe(r, lo, f) != 0) return -1;
+    trace_event_t ev;
+    while (r->next < index) {
+        if (!trace_next(r, f, &ev)) return -1;
+    }
+    return 0;
+}
+
+int trace_seek_time(trace_reader_t *r, long long ts, trace_frame_t *f) {
+    // last keyframe taken at or before ts
+    long lo = 0, hi = r->nkeys - 1;
+    while (lo < hi) {
+        long mid = (lo + hi + 1) / 2;
+        if (r->keys[mid].ts <= ts) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    if (load_keyframe(r, lo, f) != 0) return -1;
+
+    // step while the next event is still at or before ts
+    for (;;) {
+        size_t pos = r->pos;
+        long next = r->next;
+        trace_frame_t save = *f;
+        trace_event_t ev;
+        if (!trace_next(r, f, &ev)) return 0;
+        if (ev.ts > ts) {
+            *f = save;
+            r->pos = pos;
+            r->next = next;
+            return 0;
+        }
+    }
+}
@@ -0,0 +1,96 @@
+// trace.h
+// Seekable binary trace of a dine run, shared by dine and dine-query.
+//
+// Layout: a header, then blocks of up to K events, each opened by a
+// keyframe holding the whole table (state and held forks of every
+// philosopher, 4 bits each), then an index of the keyframes and a fixed
+// trailer pointing at it. Events are varint deltas from the previous
+// timestamp. A reader jumps to any event number or time by binary
+// searching the index and replaying at most K events.
+//
+// The writer streams: blocks go to the file as they fill, and only the
+// index waits for the end. When tracing resumes after a gap, a sync
+// keyframe carries a fresh snapshot of the table; readers see it as a
+// TRACE_SYNC event whose frame is that snapshot.
+//
+// Forks sit in a ring: philosopher p's left fork is p, its right fork
+// is (p + 1) % n.
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+
+#define TRACE_MAX_N 256
+
+// event kinds, as dine's tracepoints name them
+enum {
+    TRACE_WAIT = 'W',       // started waiting for fork arg
+    TRACE_GRANT = 'G',      // shown holding fork arg
+    TRACE_POST = 'P',       // shown putting fork arg down
+    TRACE_STATE = 'S',      // state changed to arg (0 changing, 1 eating,
+                            // 2 thinking)
+    TRACE_SYNC = 'Y',       // the table was resnapshotted (pid -1)
+};
+
+typedef struct {
+    long long ts;           // ns since the run started
+    int kind, pid, arg;
+}
+trace_event_t;
+
+// the table after `index` events, the last of them at `ts`
+typedef struct {
+    int n;
+    long index;
+    long long ts;
+    unsigned char state[TRACE_MAX_N];
+    unsigned char hold[TRACE_MAX_N];   // bit 0 left fork, bit 1 right fork
+}
+trace_frame_t;
+
+typedef struct trace_writer trace_writer_t;
+typedef struct trace_reader trace_reader_t;
+
+// starts a trace of a table of n; NULL with a message on stderr on
+// failure. The first trace_sync gives the starting table.
+trace_writer_t *trace_create(const char *path, int n, int keyframe_every);
+
+// appends one event; one earlier than the last is moved up to its time
+int trace_append(trace_writer_t *w, const trace_event_t *ev);
+
+// the table is now *f, at f->ts: the trace's first keyframe the first
+// time, a TRACE_SYNC after that
+int trace_sync(trace_writer_t *w, const trace_frame_t *f);
+
+// writes the index and closes the file; 0 on success
+int trace_end(trace_writer_t *w);
+
+// applies one event to a frame
+void trace_apply(trace_frame_t *f, const trace_event_t *ev);
+
+// opens a trace; NULL with a message on stderr on failure
+trace_reader_t *trace_open(const char *path);
+void trace_close(trace_reader_t *r);
+
+// a second cursor over the same loaded trace, for another thread; close
+// it before the reader it came from
+trace_reader_t *trace_dup(const trace_reader_t *r);
+
+int trace_n(const trace_reader_t *r);
+long trace_count(const trace_reader_t *r);
+long trace_keyframes(const trace_reader_t *r);
+
+// index of the first event after keyframe k
+long trace_keyframe_event(const trace_reader_t *r, long k);
+
+// positions the reader so the next trace_next returns event index;
+// fills *f with the table before that event. 0 on success
+int trace_seek_event(trace_reader_t *r, long index, trace_frame_t *f);
+
+// as above, to just after the last event at or before ts
+int trace_seek_time(trace_reader_t *r, long long ts, trace_frame_t *f);
+
+// the next event, applied to *f; 1 if there was one, 0 at the end
+int trace_next(trace_reader_t *r, trace_frame_t *f, trace_event_t *ev);
+
+#endif